@@ -92,10 +92,13 @@ static void dumptree(Node* n, int recurse, int depth = 0, const char* title = NU
             case FOLDERNODE:
                 cout << "folder";
 
-                for (share_map::iterator it = n->outshares.begin(); it != n->outshares.end(); it++)
+                if (n->outshares)
                 {
-                    if (it->first) cout << ", shared with " << it->second->user->email << ", access " << accesslevels[it->second->access];
-                    else cout << ", shared as exported folder link";
+                    for (share_map::iterator it = n->outshares->begin(); it != n->outshares->end(); it++)
+                    {
+                        if (it->first) cout << ", shared with " << it->second->user->email << ", access " << accesslevels[it->second->access];
+                        else cout << ", shared as exported folder link";
+                    }
                 }
 
                 if (n->inshare) cout << ", inbound " << accesslevels[n->inshare->access] << " share";
@@ -53,7 +53,11 @@
 #include "mega/utils.h"
 #include "mega/logging.h"
 #include "mega/waiter.h"
+#include "mega/thread.h"
+#include "mega/workerpool.h"
 
+#include "mega/nodetable.h"
+#include "mega/slab.h"
 #include "mega/node.h"
 #include "mega/sync.h"
 #include "mega/transfer.h"
@@ -63,6 +67,7 @@
 
 // target-specific headers
 #include "megawaiter.h"
+#include "megathread.h"
 #include "meganet.h"
 #include "megafs.h"
 #include "megaconsole.h"
@@ -70,6 +75,7 @@
 
 #include "mega/db/sqlite.h"
 #include "mega/db/bdb.h"
+#include "mega/db/logdb.h"
 
 #include "mega/gfx/freeimage.h"
 
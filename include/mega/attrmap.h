@@ -26,8 +26,41 @@
 
 namespace mega {
 
-// maps attribute names to attribute values
-typedef map<nameid, string> attr_map;
+// maps attribute names to attribute values - a vector sorted by name is far
+// more compact than a std::map for the handful of attributes an object
+// carries (note that insertions invalidate iterators and references)
+class MEGA_API AttrVector
+{
+public:
+    typedef pair<nameid, string> value_type;
+    typedef vector<value_type>::iterator iterator;
+    typedef vector<value_type>::const_iterator const_iterator;
+
+    iterator begin() { return v.begin(); }
+    iterator end() { return v.end(); }
+    const_iterator begin() const { return v.begin(); }
+    const_iterator end() const { return v.end(); }
+
+    size_t size() const { return v.size(); }
+    bool empty() const { return v.empty(); }
+    void clear() { v.clear(); }
+
+    iterator find(nameid);
+    const_iterator find(nameid) const;
+
+    string& operator[](nameid);
+
+    void erase(iterator it) { v.erase(it); }
+    void swap(AttrVector& other) { v.swap(other.v); }
+    size_t erase(nameid);
+
+private:
+    vector<value_type> v;
+
+    iterator lowerbound(nameid);
+};
+
+typedef AttrVector attr_map;
 
 struct MEGA_API AttrMap
 {
@@ -28,10 +28,16 @@ namespace mega {
 // modified base64 encoding/decoding (unpadded, -_ instead of +/)
 class MEGA_API Base64
 {
+    static const char alphabet[];
+    static const byte values[256];
+
     static byte to64(byte);
     static byte from64(byte);
 
 public:
+    // decode using SSSE3 (set at startup if supported by the CPU)
+    static bool usessse3;
+
     static int btoa(const byte*, int, char*);
     static int atob(const char*, byte*, int);
 };
@@ -51,6 +51,9 @@ public:
     char level;
     bool persistent;
 
+    // the result can be processed while it is still being received
+    bool incremental;
+
     void cmd(const char*);
     void notself(MegaClient*);
     virtual void cancel(void);
@@ -76,6 +79,14 @@ public:
 
     virtual void procresult();
 
+    // consume the complete leading part of the (first) result of a request
+    // in flight
+    virtual void procpartial(HttpReq*) { }
+
+    // the response was lost - undo the effects of procpartial() before the
+    // request is retried
+    virtual void cancelpartial() { }
+
     const char* getstring() const;
 
     Command();
@@ -90,6 +101,9 @@ struct MEGA_API HttpReqCommandPutFA : public HttpReq, public Command
     fatype type;
     string* data;
 
+    // retry timer
+    BackoffTimer bt;
+
     void procresult();
 
     HttpReqCommandPutFA(MegaClient*, handle, fatype, string*);
@@ -212,8 +226,13 @@ public:
 // reload nodes/shares/contacts
 class MEGA_API CommandFetchNodes : public Command
 {
+    // nodes received before their parents
+    node_vector orphans;
+
 public:
     void procresult();
+    void procpartial(HttpReq*);
+    void cancelpartial();
 
     CommandFetchNodes(MegaClient*);
 };
@@ -78,6 +78,10 @@ public:
 
     void ctr_crypt(byte *, unsigned, m_off_t, ctr_iv, byte *, int);
 
+    // run ctr_crypt() through the AES-NI kernel (set at startup if the CPU
+    // supports it, can be cleared to force the portable code path)
+    static bool useaesni;
+
     static void setint64(int64_t, byte*);
 
     static void xorblock(const byte*, byte*);
@@ -134,9 +138,18 @@ class MEGA_API HashCRC32
 {
     CryptoPP::CRC32 hash;
 
+    // CRC register of the PCLMUL path
+    uint32_t crc;
+
 public:
+    // compute using carry-less multiplication (set at startup if supported
+    // by the CPU - must not change while a CRC is being computed)
+    static bool usepclmul;
+
     void add(const byte*, unsigned);
     void get(byte*);
+
+    HashCRC32();
 };
 } // namespace
 
@@ -46,6 +46,9 @@ public:
     bool put(uint32_t, string*);
     bool put(uint32_t, Cachable *, SymmCipher*);
 
+    // allocate the id for a new record of the given type
+    uint32_t newid(uint32_t);
+
     // delete specific record
     virtual bool del(uint32_t) = 0;
 
@@ -0,0 +1,144 @@
+/**
+ * @file logdb.h
+ * @brief Append-only log/snapshot DB access layer
+ *
+ * (c) 2013-2014 by Mega Limited, Wellsford, New Zealand
+ *
+ * This file is part of the MEGA SDK - Client Access Engine.
+ *
+ * Applications using the MEGA API must present a valid application key
+ * and comply with the the rules set forth in the Terms of Service.
+ *
+ * The MEGA SDK is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @copyright Simplified (2-clause) BSD License.
+ *
+ * You should have received a copy of the license along with this
+ * program.
+ */
+
+#ifndef MEGA_DB_LOGDB_H
+#define MEGA_DB_LOGDB_H 1
+
+#include "mega/db.h"
+
+namespace mega {
+// each table consists of a snapshot file, which is memory-mapped and read
+// sequentially on startup, and a log of committed transactions that is
+// periodically merged into a fresh snapshot (no external dependencies -
+// available in all builds, made the default DBACCESS_CLASS by USE_LOGDB)
+class MEGA_API LogDbAccess : public DbAccess
+{
+    string dbpath;
+
+public:
+    DbTable* open(FileSystemAccess*, string*);
+
+    LogDbAccess(string* = NULL);
+};
+
+class MEGA_API LogDbTable : public DbTable
+{
+    // special record lengths in the log
+    static const uint32_t DELETED = 0xffffffff;
+    static const uint32_t TRUNCATED = 0xfffffffe;
+    static const uint32_t COMMITTED = 0xfffffffd;
+
+    static const unsigned RECORDHEADER = 2 * sizeof(uint32_t);
+    static const unsigned SNAPSHOTHEADER = 16;
+
+    // the log is merged into a new snapshot once it exceeds this size and
+    // half the size of the snapshot
+    static const m_off_t MINCOMPACTSIZE = 4194304;
+
+    FileSystemAccess* fsaccess;
+
+    string snapshotname, tmpsnapshotname, logname;
+
+    // mapped (or read) snapshot
+    FileAccess* snapshotfa;
+    const char* snapshot;
+    m_off_t snapshotsize;
+    string snapshotbuf;
+
+    // snapshot records by ascending id (len is DELETED if superseded)
+    struct SnapshotRecord
+    {
+        uint32_t id;
+        uint32_t len;
+        m_off_t offset;
+    };
+
+    vector<SnapshotRecord> snapshotrecords;
+
+    // committed transactions since the snapshot was written
+    string logdata;
+
+    // their current records (by offset into logdata)
+    struct LogRecord
+    {
+        size_t offset;
+        uint32_t len;
+    };
+
+    typedef map<uint32_t, LogRecord> logrecord_map;
+    logrecord_map logrecords;
+
+    FileAccess* logfa;
+    m_off_t logsize;
+
+    // log size that triggers compaction
+    m_off_t compactlogsize;
+
+    // current transaction in log format
+    string txn;
+    bool intxn;
+
+    // a log write failed: the cache has been discarded, further
+    // transactions are dropped
+    bool failed;
+
+    // sequential read cursor
+    size_t snapshotcursor;
+    logrecord_map::iterator logcursor;
+
+    static void addrecord(string*, uint32_t, uint32_t, const char* = NULL);
+    static uint32_t checksum(const char*, size_t);
+
+    SnapshotRecord* findsnapshotrecord(uint32_t);
+
+    void unmapsnapshot();
+    bool mapsnapshot();
+    bool readsnapshot();
+    void replay();
+    void apply(size_t, size_t);
+    bool compact();
+    bool resetlog();
+    void fail();
+
+public:
+    bool load(string*);
+
+    void rewind();
+    bool next(uint32_t*, string*);
+    bool get(uint32_t, string*);
+    bool put(uint32_t, char*, unsigned);
+    bool del(uint32_t);
+    void truncate();
+    void begin();
+    void commit();
+    void abort();
+
+    LogDbTable(FileSystemAccess*);
+    ~LogDbTable();
+};
+} // namespace
+
+#endif
+
+#ifdef USE_LOGDB
+#undef DBACCESS_CLASS
+#define DBACCESS_CLASS LogDbAccess
+#endif
@@ -31,9 +31,14 @@ class MEGA_API SqliteDbAccess : public DbAccess
     string dbpath;
 
 public:
+    // PRAGMA synchronous level of the (WAL-journaled) state cache databases:
+    // 0 (OFF), 1 (NORMAL - a crash may lose the most recent commits, but
+    // cannot corrupt the database) or 2 (FULL)
+    int synchronous;
+
     DbTable* open(FileSystemAccess*, string*);
 
-    SqliteDbAccess(string* = NULL);
+    SqliteDbAccess(string* = NULL, int = 1);
     ~SqliteDbAccess();
 };
 
@@ -42,6 +47,13 @@ class MEGA_API SqliteDbTable : public DbTable
     sqlite3* db;
     sqlite3_stmt* pStmt;
 
+    // prepared on first use and kept for the lifetime of the table
+    sqlite3_stmt* pGetStmt;
+    sqlite3_stmt* pPutStmt;
+    sqlite3_stmt* pDelStmt;
+
+    sqlite3_stmt* prepare(sqlite3_stmt**, const char*);
+
 public:
     void rewind();
     bool next(uint32_t*, string*);
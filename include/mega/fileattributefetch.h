@@ -35,9 +35,23 @@ struct MEGA_API FileAttributeFetchChannel
     BackoffTimer bt;
     HttpReq req;
 
+    // record index of the response (handle/position pairs)
+    string index;
+
     // index of next element to complete (starts at 0)
     size_t completed;
 
+    // response offset of req.in (delivered data is purged from incremental
+    // requests)
+    size_t inbase;
+
+    // bytes received at the time of the last parse()
+    m_off_t parsed;
+
+    // maximum size of undelivered attribute data held by an incremental
+    // request
+    static const size_t MAXBUFFERED = 4194304;
+
     // post request to target URL
     void dispatch(MegaClient*, int, const char*);
 
@@ -57,8 +71,88 @@ struct MEGA_API FileAttributeFetch
     unsigned char retries;
     int tag;
 
+    // attribute data (served from the cache)
+    string data;
+
     FileAttributeFetch(handle, fatype, int, int);
 };
+
+// decrypted file attributes by node handle and type - kept in memory and,
+// optionally, in an encrypted table, with the least recently used ones
+// evicted once the size limits are exceeded
+class MEGA_API FileAttributeCache
+{
+    struct Entry : public Cachable
+    {
+        handle nodehandle;
+        fatype type;
+
+        // file attribute handle (changes if the attribute is replaced)
+        handle fah;
+
+        // attribute data (empty if only held in the table)
+        string data;
+        uint32_t size;
+
+        // position in lru and memlru
+        list<Entry*>::iterator lruit;
+        list<Entry*>::iterator memlruit;
+
+        // (record header)
+        bool serialize(string*);
+        static Entry* unserialize(string*);
+    };
+
+    // table records: encrypted header, followed by the separately encrypted
+    // data, which is only decrypted once requested
+    static const unsigned RECORDHEADER = 32;
+
+    typedef map<pair<handle, fatype>, Entry*> entry_map;
+    entry_map entries;
+
+    // all entries / entries with data in memory (most recently used first)
+    list<Entry*> lru;
+    list<Entry*> memlru;
+
+    DbTable* table;
+    SymmCipher* key;
+
+    bool store(Entry*);
+    bool load(Entry*);
+    void touch(Entry*);
+    void unload(Entry*);
+    void remove(Entry*);
+    void trim();
+
+public:
+    // size limits (memory: attribute data, table: all entries)
+    size_t maxmemory;
+    m_off_t maxdisk;
+
+    // current sizes
+    size_t memsize;
+    m_off_t disksize;
+
+    // lookups served from the cache / not found or outdated
+    unsigned hits;
+    unsigned misses;
+
+    // retrieve attribute if present with the given attribute handle
+    bool get(handle, fatype, handle, string*);
+
+    // store attribute
+    void put(handle, fatype, handle, const char*, uint32_t);
+
+    // back the cache with a table (records encrypted with the supplied key)
+    void attach(DbTable*, SymmCipher*);
+    bool attached() const;
+
+    // close table and discard all entries
+    void reset();
+
+    FileAttributeCache(size_t, m_off_t);
+    ~FileAttributeCache();
+};
 } // namespace
 
 #endif
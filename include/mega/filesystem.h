@@ -54,7 +54,8 @@ struct MEGA_API FileAccess
     // for files "opened" in nonblocking mode, the current local filename
     string localname;
 
-    // open for reading, writing or reading and writing
+    // open for reading, writing or reading and writing (reading and writing
+    // creates the file if needed and preserves its contents)
     virtual bool fopen(string*, bool, bool) = 0;
 
     // open by name only
@@ -69,6 +70,14 @@ struct MEGA_API FileAccess
     // absolute position read to byte buffer
     bool frawread(byte *, unsigned, m_off_t);
 
+    // read a batch of equal-sized blocks at ascending positions into
+    // consecutive buffer space with a single open (nearby blocks are
+    // coalesced into one read)
+    bool frawread(byte *, unsigned, const m_off_t*, unsigned);
+
+    static const unsigned COALESCEGAP = 4096;
+    static const unsigned COALESCESPAN = 65536;
+
     // non-locking ops: open/close temporary hFile
     bool openf();
     void closef();
@@ -76,6 +85,10 @@ struct MEGA_API FileAccess
     // absolute position write
     virtual bool fwrite(const byte *, unsigned, m_off_t) = 0;
 
+    // map a file opened for reading into memory (NULL if unsupported or
+    // failed) - the mapping is released with the FileAccess object
+    virtual const byte* fmap() { return NULL; }
+
     // system-specific raw read/open/close
     virtual bool sysread(byte *, unsigned, m_off_t) = 0;
     virtual bool sysstat(m_time_t*, m_off_t*) = 0;
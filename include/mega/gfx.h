@@ -22,16 +22,23 @@
 #ifndef GFX_H
 #define GFX_H 1
 
+#include "workerpool.h"
+
 namespace mega {
 using namespace std;
 
+struct GfxJob;
+
 // bitmap graphics processor
 class MEGA_API GfxProc
 {
-    // read and store bitmap
+    // read and store bitmap (the longest side needs to be at least the
+    // given size - implementations can use it to decode at a reduced scale)
     virtual bool readbitmap(FileAccess*, string*, int) = 0;
 
-    // resize stored bitmap and store result as JPEG
+    // resize stored bitmap and store result as JPEG (invoked for the
+    // dimensions in descending order, so that the implementation can derive
+    // each one from the previous)
     virtual bool resizebitmap(int, int, string*) = 0;
     
     // free stored bitmap
@@ -41,9 +48,30 @@ protected:
     // coordinate transformation
     static void transform(int&, int&, int&, int&, int&, int&);
 
+    // decoding size for square crops as a multiple of the crop size
+    static const int CROPHEADROOM = 4;
+
     // list of supported extensions (NULL if no pre-filtering is needed)
     virtual const char* supportedformats();
 
+    // new processor instance of the same kind for use on a worker thread
+    // (NULL: bitmaps are processed synchronously by this instance)
+    virtual GfxProc* newprocessor();
+
+    // jobs waiting for a processor instance and jobs being processed
+    deque<GfxJob*> queuedjobs;
+    set<GfxJob*> runningjobs;
+
+    // processor instances (all / not assigned to a job)
+    vector<GfxProc*> processors;
+    vector<GfxProc*> idleprocessors;
+
+    // maximum number of images processed concurrently
+    static const unsigned MAXPROCESSORS = 4;
+
+    // assign idle processor instances to queued jobs
+    void dispatch();
+
 public:
     // check whether the filename looks like a supported image type
     bool isgfx(string*);
@@ -52,8 +80,27 @@ public:
     // handle is uploadhandle or nodehandle
     // - must respect JPEG EXIF rotation tag
     // - must save at 85% quality (120*120 pixel result: ~4 KB)
+    // (the bitmap is processed on the worker threads if available - the
+    // resulting file attributes are stored from MegaClient::exec())
     void gendimensionsputfa(FileAccess*, string*, handle, SymmCipher*, int = -1);
 
+    // decode the bitmap and generate the missing dimensions (JPEG data by
+    // meta_t, empty if not generated) - may be called from a worker thread
+    void genimages(FileAccess*, string*, int, vector<string>*);
+
+    // deliver the generated images of a finished job
+    void completejob(GfxJob*);
+
+    // abort all pending jobs
+    void canceljobs();
+
+    // number of queued and running jobs
+    unsigned pendingjobs() const;
+
+    // number of completed jobs and their cumulative queueing + processing time
+    unsigned jobsdone;
+    dstime jobsds;
+
     // FIXME: read dynamically from API server
     typedef enum { THUMBNAIL120X120, PREVIEW1000x1000 } meta_t;
     
@@ -63,8 +110,32 @@ public:
     
     MegaClient* client;
 
-    GfxProc() { }
-    virtual ~GfxProc() { }
+    GfxProc();
+    virtual ~GfxProc();
+};
+
+// thumbnail/preview generation for one image, performed on a worker thread
+// by a dedicated processor instance
+struct MEGA_API GfxJob : public WorkerJob
+{
+    GfxProc* gfx;
+    GfxProc* processor;
+
+    string localfilename;
+    handle th;
+    int missing;
+
+    // copy of the file key (the caller's may be transient)
+    byte key[SymmCipher::KEYLENGTH];
+
+    // generated JPEG data by meta_t
+    vector<string> images;
+
+    // time of queueing
+    dstime queuedds;
+
+    void run();
+    void complete(MegaClient*);
 };
 } // namespace
 
@@ -29,15 +29,20 @@ namespace mega {
 // bitmap graphics processor
 class MEGA_API GfxProcFreeImage : public GfxProc
 {
+    // decoded bitmap and its (original) dimensions
     FIBITMAP* dib;
     int w, h;
 
+    // scaled bitmap of the previous dimension
+    FIBITMAP* level;
+
     bool readbitmap(FileAccess*, string*, int);
     bool resizebitmap(int, int, string*);
     void freebitmap();
 
 protected:
     const char* supportedformats();
+    GfxProc* newprocessor();
 };
 } // namespace
 
@@ -64,6 +64,7 @@ protected:
     static const char* supportedformatsQT();
 
     const char* supportedformats();
+    GfxProc* newprocessor();
 
 public:
     static int getExifOrientation(QString &filePath);
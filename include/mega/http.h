@@ -62,6 +62,10 @@ struct MEGA_API HttpIO : public EventTrigger
     // set whenever a network request completes successfully
     bool success;
 
+    // set if response data is delivered exclusively through HttpReq::put()
+    // from within doio(), so that it can be consumed while still in flight
+    bool syncput;
+
     // post request to target URL
     virtual void post(struct HttpReq*, const char* = NULL, unsigned = 0) = 0;
 
@@ -109,6 +113,10 @@ struct MEGA_API HttpReq
     // we assume that API responses are smaller than 4 GB
     m_off_t contentlength;
 
+    // response is consumed (and purged from in) while still in flight - no
+    // space is reserved for the full content length
+    bool incremental;
+
     // HttpIO implementation-specific identifier for this connection
     void* httpiohandle;
 
@@ -155,6 +163,9 @@ struct MEGA_API HttpReqXfer : public HttpReq
     virtual bool prepare(FileAccess *, const char*, SymmCipher *, chunkmac_map *, uint64_t, m_off_t, m_off_t) = 0;
     virtual void finalize(FileAccess*, SymmCipher*, chunkmac_map*, uint64_t, m_off_t, m_off_t) { }
 
+    // CTR-crypt a run of consecutive chunks, yielding one MAC per chunk
+    static void chunkcrypt(SymmCipher*, byte*, unsigned, m_off_t, uint64_t, chunkmac_map*, int);
+
     HttpReqXfer() : HttpReq(1) { }
 };
 
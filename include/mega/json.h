@@ -61,6 +61,14 @@ struct MEGA_API JSON
     bool storeobject(string* = NULL);
 
     static void unescape(string*);
+
+    // locate the closing quote of a string value (ptr points past the
+    // opening quote) - NULL if the string is unterminated
+    static const char* stringend(const char*);
+
+    // string scanning kernel: 0 (portable), 1 (SSE2) or 2 (AVX2) - set at
+    // startup to the best one supported by the CPU, can be lowered
+    static int simd;
 };
 
 } // namespace
@@ -33,6 +33,9 @@
 #include "backofftimer.h"
 #include "http.h"
 #include "pubkeyaction.h"
+#include "workerpool.h"
+#include "nodetable.h"
+#include "slab.h"
 
 namespace mega {
 extern bool debug;
@@ -140,6 +143,10 @@ public:
     // number of parallel connections per transfer (PUT/GET)
     unsigned char connections[2];
 
+    // set number of worker threads for chunk encryption/decryption and
+    // related file I/O (0: run on the engine thread)
+    void setworkerthreads(unsigned);
+
     // generate & return next upload handle
     handle uploadhandle(int);
 
@@ -156,6 +163,10 @@ public:
     // queue file attribute retrieval
     error getfa(Node*, fatype, int = 0);
 
+    // enable the cache of retrieved file attributes with the given memory
+    // and table size limits (0, 0: disable)
+    void setfacache(size_t, m_off_t);
+
     // attach/update/delete user attribute
     void putua(const char*, const byte* = NULL, unsigned = 0, int = 0);
 
@@ -184,6 +195,9 @@ public:
     // maximum outbound throughput (per target server)
     int putmbpscap;
 
+    // number of queued and in-flight file attribute writes
+    unsigned queuedputfa() const;
+
     // shopping basket
     handle_vector purchase_basket;
 
@@ -237,12 +251,28 @@ private:
     // next local user record identifier to use
     int userid;
 
-    // pending file attribute writes
-    putfa_list newfa;
+    // queued file attribute writes that can be attached right away
+    // (existing node or completed upload)
+    putfa_list readyfa;
+
+    // queued file attribute writes of uploads still in progress
+    handleputfa_map uploadfa;
+    unsigned uploadfacount;
+
+    // failed file attribute writes awaiting their retry
+    putfa_list retryfa;
+
+    // in-flight file attribute writes
+    putfa_list activefa;
+
+    // maximum number of concurrent file attribute writes
+    static const unsigned MAXPUTFA = 8;
 
-    // current attribute being sent
-    putfa_list::iterator curfa;
-    BackoffTimer btpfa;
+    // queue a file attribute write as ready or pending upload completion
+    void queueputfa(HttpReqCommandPutFA*);
+
+    // start queued file attribute writes (ready ones first)
+    void dispatchputfa();
 
     // pending file attribute reads, grouped by queued file attribute
     // retrievals
@@ -323,6 +353,13 @@ public:
 
     // bitmap graphics handling
     GfxProc* gfx;
+
+    // worker threads for CPU-intensive tasks
+    WorkerPool* workers;
+
+    // Node and LocalNode memory
+    SlabAllocator* nodeslab;
+    SlabAllocator* localnodeslab;
     
     // DB access
     DbAccess* dbaccess;
@@ -375,6 +412,13 @@ public:
     // file attribute fetches
     faf_map fafs;
 
+    // file attribute cache (NULL if disabled) and cache hits pending delivery
+    FileAttributeCache* facache;
+    faf_map fafcached;
+
+    // open the file attribute cache table of the logged in user
+    void openfatable();
+
     // generate attribute string based on the pending attributes for this upload
     void pendingattrstring(handle, string*);
 
@@ -410,7 +454,7 @@ public:
 
     bool setscsn(JSON*);
 
-    void purgenodes(node_vector* = NULL);
+    void purgenodes();
     void purgeusers(user_vector* = NULL);
     bool readusers(JSON*);
 
@@ -533,12 +577,15 @@ public:
     // file attribute fetch failed
     void faf_failed(int);
 
+    // file attribute data received but not parsed yet?
+    bool fafcreceived();
+
     // transfer chunk failed
     void setchunkfailed(string*);
     string badhosts;
     
     // process object arrays by the API server
-    int readnodes(JSON*, int, putsource_t = PUTNODES_APP, NewNode* = NULL, int = 0);
+    int readnodes(JSON*, int, putsource_t = PUTNODES_APP, NewNode* = NULL, int = 0, node_vector* = NULL);
 
     void readok(JSON*);
     void readokelement(JSON*);
@@ -580,6 +627,10 @@ public:
     // folder link access: folder key
     SymmCipher key;
 
+    // most recently expanded node key (see Node::nodecipher())
+    SymmCipher tmpnodecipher;
+    handle tmpnodecipherhandle;
+
     // account access (full account): RSA key
     AsymmCipher asymkey;
 
@@ -588,6 +639,9 @@ public:
     
     // apply keys
     int applykeys();
+    int applykeys(node_vector*);
+    bool queuenodekey(Node*, vector<WorkerJob*>*);
+    void runnodekeyjobs(vector<WorkerJob*>*);
 
     // symmetric password challenge
     int checktsid(byte* sidbuf, unsigned len);
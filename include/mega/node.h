@@ -25,6 +25,7 @@
 #include "filefingerprint.h"
 #include "file.h"
 #include "attrmap.h"
+#include "workerpool.h"
 
 namespace mega {
 struct MEGA_API NodeCore
@@ -67,6 +68,29 @@ struct MEGA_API NewNode : public NodeCore
     }
 };
 
+// serialized node decoded without touching engine state, so that cached nodes
+// can be decoded on worker threads (see Node::unserialize())
+struct MEGA_API NodeRecord
+{
+    handle h, ph, owner;
+    nodetype_t type;
+    m_off_t size;
+    m_time_t clienttimestamp, ctime;
+
+    // (pointers into the serialized data)
+    const byte* key;
+    const char* fileattrstring;
+    const byte* sharekey;
+    const char* shares;
+    const char* end;
+
+    short numshares;
+
+    AttrMap attrs;
+
+    bool decode(const string*);
+};
+
 // filesystem node
 struct MEGA_API Node : public NodeCore, Cachable, FileFingerprint
 {
@@ -84,14 +108,25 @@ struct MEGA_API Node : public NodeCore, Cachable, FileFingerprint
     // try to resolve node key string
     bool applykey();
 
+    // locate the part of keystring that we can decrypt and the key to
+    // decrypt it with (NULL: no suitable key available yet)
+    const char* findkey(SymmCipher**);
+
     // decrypt attribute string and set fileattrs
     void setattr();
 
+    // decrypt and parse an attribute string (does not touch engine state)
+    static bool parseattr(SymmCipher*, const string*, attr_map*);
+
+    // finish attribute update after parseattr()
+    void applyattr();
+
     // display name (UTF-8)
     const char* displayname() const;
 
-    // node-specific key
-    SymmCipher key;
+    // node-specific cipher, expanded on demand from nodekey (valid until the
+    // next call for a different node, NULL if the key is not available)
+    SymmCipher* nodecipher();
 
     // node attributes
     AttrMap attrs;
@@ -116,8 +151,8 @@ struct MEGA_API Node : public NodeCore, Cachable, FileFingerprint
     // inbound share
     Share* inshare;
 
-    // outbound shares by user
-    share_map outshares;
+    // outbound shares by user (NULL unless shared)
+    share_map* outshares;
 
     // incoming/outgoing share key
     SymmCipher* sharekey;
@@ -154,6 +189,25 @@ struct MEGA_API Node : public NodeCore, Cachable, FileFingerprint
     // own position in parent's children
     node_list::iterator child_it;
 
+    // children by display name - only built for folders with at least
+    // NAMEINDEXTHRESHOLD children, then maintained until the node is deleted
+    namenode_map* childnames;
+    static const unsigned NAMEINDEXTHRESHOLD = 64;
+
+    // number of indexed names containing escape sequences ('%')
+    unsigned escapedchildnames;
+
+    // own position in parent's childnames (if indexed)
+    namenode_map::iterator childname_it;
+    bool nameindexed;
+
+    // build childnames if the folder is large enough, returns NULL otherwise
+    namenode_map* namedchildren();
+
+    // (re)insert/remove own display name in parent's childnames
+    void indexname();
+    void unindexname();
+
     // own position in fingerprint set (only valid for file nodes)
     fingerprint_set::iterator fingerprint_it;
 
@@ -177,6 +231,12 @@ struct MEGA_API Node : public NodeCore, Cachable, FileFingerprint
 
     bool serialize(string*);
     static Node* unserialize(MegaClient*, string*, node_vector*);
+    static Node* unserialize(MegaClient*, NodeRecord*, node_vector*);
+
+    // allocated from the client's node slab
+    static void* operator new(size_t, MegaClient*);
+    static void operator delete(void*, MegaClient*);
+    static void operator delete(void*);
 
     Node(MegaClient*, vector<Node*>*, handle, handle, nodetype_t, m_off_t, handle, const char*, m_time_t, m_time_t);
     ~Node();
@@ -263,8 +323,74 @@ struct MEGA_API LocalNode : public File, Cachable
     virtual bool serialize(string*);
     static LocalNode* unserialize( Sync* sync, string* sData );
 
+    // allocated from the client's LocalNode slab
+    static void* operator new(size_t, MegaClient*);
+    static void operator delete(void*, MegaClient*);
+    static void operator delete(void*);
+
     ~LocalNode();
 };
+
+// node key unwrapping and attribute decryption for a batch of nodes on a
+// worker thread (symmetric keys only) - the results are applied by complete()
+struct MEGA_API NodeKeyJob : public WorkerJob
+{
+    static const unsigned MAXITEMS = 1024;
+
+    struct Item
+    {
+        Node* node;
+
+        // encrypted node key (points into node->keystring)
+        const char* k;
+
+        // raw key that k was encrypted with
+        byte sk[SymmCipher::KEYLENGTH];
+
+        // decrypted node key and attributes
+        byte key[FILENODEKEYLENGTH];
+        attr_map attrs;
+
+        bool keyok;
+        bool attrok;
+    };
+
+    vector<Item> items;
+
+    // queue node, returns false if k is not a symmetric key
+    bool add(Node*, const char*, SymmCipher*);
+
+    void run();
+    void complete(MegaClient*);
+};
+
+// decryption of a batch of state cache records (and decoding of the node
+// records among them) on a worker thread - see MegaClient::fetchsc()
+struct MEGA_API CacheRecordJob : public WorkerJob
+{
+    static const unsigned MAXRECORDS = 1024;
+
+    struct Item
+    {
+        uint32_t id;
+        string data;
+        bool decrypted;
+        bool decoded;
+        NodeRecord node;
+    };
+
+    vector<Item> items;
+
+    // private copy of the master key (cipher contexts are not thread-safe)
+    SymmCipher key;
+
+    void add(uint32_t, string*);
+
+    void run();
+    void complete(MegaClient*) { }
+
+    CacheRecordJob(SymmCipher*);
+};
 } // namespace
 
 #endif
@@ -0,0 +1,136 @@
+/**
+ * @file mega/nodetable.h
+ * @brief Hash table mapping node handles to nodes
+ *
+ * (c) 2013-2014 by Mega Limited, Wellsford, New Zealand
+ *
+ * This file is part of the MEGA SDK - Client Access Engine.
+ *
+ * Applications using the MEGA API must present a valid application key
+ * and comply with the the rules set forth in the Terms of Service.
+ *
+ * The MEGA SDK is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @copyright Simplified (2-clause) BSD License.
+ *
+ * You should have received a copy of the license along with this
+ * program.
+ */
+
+#ifndef MEGA_NODETABLE_H
+#define MEGA_NODETABLE_H 1
+
+#include "types.h"
+
+namespace mega {
+// open-addressing hash table (linear probing, backward-shift deletion) with
+// a std::map-like interface - iteration order is arbitrary and iterators are
+// invalidated by insertions (but not by changing a Node* through them)
+class MEGA_API NodeTable
+{
+public:
+    typedef pair<handle, Node*> value_type;
+
+    class iterator
+    {
+        value_type* ptr;
+        value_type* end;
+
+        // skip empty slots
+        void skip()
+        {
+            while (ptr != end && !ptr->second)
+            {
+                ptr++;
+            }
+        }
+
+    public:
+        value_type& operator*() const
+        {
+            return *ptr;
+        }
+
+        value_type* operator->() const
+        {
+            return ptr;
+        }
+
+        iterator& operator++()
+        {
+            ptr++;
+            skip();
+            return *this;
+        }
+
+        iterator operator++(int)
+        {
+            iterator t = *this;
+            ++*this;
+            return t;
+        }
+
+        bool operator==(const iterator& it) const
+        {
+            return ptr == it.ptr;
+        }
+
+        bool operator!=(const iterator& it) const
+        {
+            return ptr != it.ptr;
+        }
+
+        iterator(value_type* p = NULL, value_type* e = NULL) : ptr(p), end(e)
+        {
+            skip();
+        }
+    };
+
+    iterator begin();
+    iterator end();
+
+    iterator find(handle);
+
+    // add or replace node (NULL is not a valid node)
+    void set(handle, Node*);
+
+    size_t erase(handle);
+
+    size_t size() const
+    {
+        return count;
+    }
+
+    void clear();
+
+    // preallocate for the given number of nodes
+    void reserve(size_t);
+
+    NodeTable();
+    ~NodeTable();
+
+private:
+    // (power of two, or 0 before the first insertion)
+    size_t capacity;
+    size_t count;
+    value_type* slots;
+
+    // handles are random, but user-supplied ones may not be - mix anyway
+    size_t home(handle h) const
+    {
+        return (size_t)((h * 0x9e3779b97f4a7c15ULL) >> 32) & (capacity - 1);
+    }
+
+    void rehash(size_t);
+
+    NodeTable(const NodeTable&);
+    NodeTable& operator=(const NodeTable&);
+};
+
+// maps node handles to Node pointers
+typedef NodeTable node_map;
+} // namespace
+
+#endif
@@ -100,6 +100,9 @@ class MEGA_API PosixFileAccess : public FileAccess
 public:
     int fd;
 
+    // fmap() result
+    void* mapped;
+
 #ifndef USE_FDOPENDIR
     DIR* dp;
 #endif
@@ -109,6 +112,7 @@ public:
     bool fread(string *, unsigned, unsigned, m_off_t);
     bool frawread(byte *, unsigned, m_off_t);
     bool fwrite(const byte *, unsigned, m_off_t);
+    const byte* fmap();
 
     bool sysread(byte *, unsigned, m_off_t);
     bool sysstat(m_time_t*, m_off_t*);
@@ -39,10 +39,28 @@ protected:
     static CURLcode ssl_ctx_function(CURL*, void*, void*);
     static int cert_verify_callback(X509_STORE_CTX*, void*);
 
+    // libcurl socket API: sockets are watched persistently by the waiter
+    static int socket_callback(CURL*, curl_socket_t, int, void*, void*);
+    static int timer_callback(CURLM*, long, void*);
+
+    // sockets in use and their PosixWaiter criteria
+    map<curl_socket_t, int> sockets;
+
+    // waiter the sockets are registered with (set by addevents())
+    PosixWaiter* waiter;
+
+    // time of the next libcurl timeout (or ~0 if none)
+    dstime curltimeoutds;
+
     curl_slist* contenttypejson;
     curl_slist* contenttypebinary;
 
+    void countconnection(CURL*);
+
 public:
+    // requests sent over a newly established vs. a reused connection
+    unsigned newconnections, reusedconnections;
+
     void post(HttpReq*, const char* = 0, unsigned = 0);
     void cancel(HttpReq*);
 
@@ -46,6 +46,7 @@
 #include <time.h>
 
 #include <sys/stat.h>
+#include <sys/mman.h>
 #include <sys/time.h>
 #include <utime.h>
 #include <stdio.h>
@@ -73,7 +74,12 @@
 #include <sys/inotify.h>
 #endif
 
+#ifdef USE_EPOLL
+#include <sys/epoll.h>
+#endif
+
 #include <sys/select.h>
+#include <poll.h>
 
 #include <curl/curl.h>
 
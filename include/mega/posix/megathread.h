@@ -0,0 +1,69 @@
+/**
+ * @file mega/posix/megathread.h
+ * @brief POSIX threading primitives (using pthreads)
+ *
+ * (c) 2013-2014 by Mega Limited, Wellsford, New Zealand
+ *
+ * This file is part of the MEGA SDK - Client Access Engine.
+ *
+ * Applications using the MEGA API must present a valid application key
+ * and comply with the the rules set forth in the Terms of Service.
+ *
+ * The MEGA SDK is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @copyright Simplified (2-clause) BSD License.
+ *
+ * You should have received a copy of the license along with this
+ * program.
+ */
+
+#ifndef THREAD_CLASS
+#define THREAD_CLASS PosixThread
+#define MUTEX_CLASS PosixMutex
+#define SEMAPHORE_CLASS PosixSemaphore
+
+#include "mega/thread.h"
+
+#include <pthread.h>
+
+namespace mega {
+struct MEGA_API PosixThread : public Thread
+{
+    pthread_t thread;
+
+    void start(void* (*)(void*), void*);
+    void join();
+
+    // number of online processor cores
+    static unsigned cores();
+};
+
+struct MEGA_API PosixMutex : public Mutex
+{
+    pthread_mutex_t mutex;
+
+    void lock();
+    void unlock();
+
+    PosixMutex();
+    ~PosixMutex();
+};
+
+// (unnamed POSIX semaphores are not available on all platforms - MacOS...)
+struct MEGA_API PosixSemaphore : public Semaphore
+{
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    unsigned count;
+
+    void release();
+    void wait();
+
+    PosixSemaphore();
+    ~PosixSemaphore();
+};
+} // namespace
+
+#endif
@@ -27,15 +27,41 @@
 namespace mega {
 struct PosixWaiter : public Waiter
 {
-    int maxfd;
-    fd_set rfds, wfds, efds;
-    fd_set ignorefds;
+    // fd readiness criteria and results
+    static const int WAITREAD = 1;
+    static const int WAITWRITE = 2;
+    static const int WAITERROR = 4;
 
-    bool fd_filter(int nfds, fd_set* fds, fd_set* ignorefds) const;
+    // persistent watch on fd (fds must be unwatched before being closed) -
+    // activity on ignored fds does not request exec()
+    void watchfd(int, int, bool = false);
+    void unwatchfd(int);
+
+    // events reported for fd by the last wait()
+    int fdevents(int) const;
+
+    // watched fds and their criteria (plus WAITIGNORE)
+    map<int, int> watchedfds;
+
+    // fds triggered during the last wait()
+    map<int, int> readyfds;
+
+    // self-pipe for wakeups from other threads
+    int notifypipe[2];
+
+#ifdef USE_EPOLL
+    int epollfd;
+#endif
 
     void init(dstime);
     int wait();
-    void bumpmaxfd(int);
+    void notify();
+
+    PosixWaiter();
+    ~PosixWaiter();
+
+protected:
+    static const int WAITIGNORE = 8;
 };
 } // namespace
 
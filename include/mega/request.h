@@ -35,6 +35,10 @@ public:
 
     int cmdspending() const;
 
+    bool incremental() const;
+    void procpartial(MegaClient*, HttpReq*);
+    void cancelpartial(MegaClient*);
+
     void get(string*) const;
 
     void procresult(MegaClient*);
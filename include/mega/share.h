@@ -40,6 +40,9 @@ struct MEGA_API Share
     void serialize(string*);
     static bool unserialize(MegaClient *, int, handle, const byte *, const char**, const char*);
 
+    // length of a serialized share
+    static const unsigned SERIALIZEDSIZE = sizeof(handle) + sizeof(m_time_t) + 2;
+
     Share(User*, accesslevel_t, m_time_t);
 };
 
@@ -0,0 +1,76 @@
+/**
+ * @file mega/slab.h
+ * @brief Fixed-size object allocator
+ *
+ * (c) 2013-2014 by Mega Limited, Wellsford, New Zealand
+ *
+ * This file is part of the MEGA SDK - Client Access Engine.
+ *
+ * Applications using the MEGA API must present a valid application key
+ * and comply with the the rules set forth in the Terms of Service.
+ *
+ * The MEGA SDK is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @copyright Simplified (2-clause) BSD License.
+ *
+ * You should have received a copy of the license along with this
+ * program.
+ */
+
+#ifndef MEGA_SLAB_H
+#define MEGA_SLAB_H 1
+
+#include "types.h"
+
+namespace mega {
+// carves objects of one size class from large blocks and recycles them
+// through a free list - blocks are only returned to the system in bulk via
+// purge() once all objects have been released (not thread-safe)
+class MEGA_API SlabAllocator
+{
+    // object size including the owner header
+    size_t objsize;
+
+    // objects per block
+    size_t blockobjs;
+
+    vector<char*> blocks;
+
+    // unallocated tail of the current block
+    char* next;
+    char* blockend;
+
+    // released objects
+    void* freelist;
+
+    size_t live;
+
+public:
+    // per-object header (keeps the payload aligned)
+    static const size_t HEADERSIZE = 16;
+
+    // allocate object of at most the configured size (larger requests fall
+    // back to the global heap)
+    void* alloc(size_t);
+
+    // heap allocation with a release()-compatible header
+    static void* heapalloc(size_t);
+
+    // release object allocated by any SlabAllocator or by heapalloc()
+    static void release(void*);
+
+    // return all blocks to the system - no-op while objects are still live
+    bool purge();
+
+    // live objects and total block memory
+    size_t inuse() const;
+    size_t footprint() const;
+
+    SlabAllocator(size_t, size_t = 4096);
+    ~SlabAllocator();
+};
+} // namespace
+
+#endif
@@ -25,6 +25,8 @@
 #include "megaclient.h"
 
 namespace mega {
+struct ScanJob;
+
 class MEGA_API Sync
 {
 public:
@@ -54,9 +56,62 @@ public:
     // recursively add children
     void addstatecachechildren(uint32_t, idlocalnode_map*, string*, LocalNode*, int);
     
-    // Caches all synchronized LocalNode
+    // Caches all synchronized LocalNode (parents before children, in
+    // batches of at most CACHEFLUSHBATCH records or CACHEFLUSHDS
+    // deciseconds - the remainder is flushed by subsequent calls)
     void cachenodes();
 
+    static const unsigned CACHEFLUSHBATCH = 16384;
+    static const dstime CACHEFLUSHDS = 2;
+
+    // insertq is being flushed over several exec() iterations
+    bool cacheflushpending;
+
+    // state cache flush statistics: flushes, records written, total and
+    // longest flush duration (ds)
+    unsigned cacheflushes;
+    unsigned cacheflushrecords;
+    dstime cacheflushds;
+    dstime cacheflushmaxds;
+
+    // fingerprint a LocalNode - the file is not read if a fingerprint
+    // prefetched for it or the LocalNode last seen with the same fsid has the
+    // same size and mtime (LocalNodes and their fingerprints persist in the
+    // state cache)
+    bool genfingerprint(LocalNode*, FileAccess*, FileFingerprint* = NULL);
+
+    // is a file with this fsid, size and mtime known and fingerprinted?
+    bool knownfile(handle, m_off_t, m_time_t);
+
+    // fingerprints reused vs. generated from file data
+    unsigned fingerprinthits;
+    unsigned fingerprintmisses;
+
+    // parallel scan stage (full scans only): folders are enumerated and their
+    // new or changed syncable files fingerprinted on the worker threads ahead
+    // of checkpath(), which claims the results by fsid
+    void startprefetch();
+    void stopprefetch();
+    void pumpprefetch();
+
+    // jobs not yet handed to the workers (fingerprinting ahead of further
+    // enumeration), jobs in progress and files fingerprinted but not yet
+    // reached by checkpath() (by fsid) - at most one job less than there are
+    // worker threads is in progress, so that other jobs always find a free
+    // thread
+    deque<ScanJob*> prefetchq;
+    set<ScanJob*> prefetchjobs;
+    handlefingerprint_map prefetched;
+
+    // maximum number of unconsumed fingerprints
+    static const unsigned MAXPREFETCHED = 65536;
+
+    // maximum duration of a procscanq() run
+    static const dstime SCANYIELDDS = 2;
+
+    // is the path inside the sync's local debris folder?
+    bool indebris(string*);
+
     // change state, signal to application
     void changestate(syncstate_t);
 
@@ -111,6 +166,43 @@ protected :
     bool readstatecache();
 
 };
+
+// parallel scan stage: enumerates one folder on a worker thread, then
+// fingerprints the files selected by the engine thread in a second job
+struct MEGA_API ScanJob : public WorkerJob
+{
+    Sync* sync;
+    FileSystemAccess* fsaccess;
+
+    string localpath;
+
+    // files to be fingerprinted (empty: enumerate the folder)
+    vector<string> names;
+
+    // enumeration results: subfolder names, files with fsid, size and mtime
+    struct Entry
+    {
+        string name;
+        handle fsid;
+        m_off_t size;
+        m_time_t mtime;
+    };
+
+    vector<string> folders;
+    vector<Entry> entries;
+
+    // fingerprinting results (by fsid)
+    handlefingerprint_map files;
+
+    // set by the engine thread to make run() return early before the job is
+    // canceled
+    volatile bool aborted;
+
+    void run();
+    void complete(MegaClient*);
+
+    ScanJob(Sync*, string*, vector<string>* = NULL);
+};
 } // namespace
 
 #endif
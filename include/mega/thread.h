@@ -0,0 +1,62 @@
+/**
+ * @file mega/thread.h
+ * @brief Generic host threading interfaces
+ *
+ * (c) 2013-2014 by Mega Limited, Wellsford, New Zealand
+ *
+ * This file is part of the MEGA SDK - Client Access Engine.
+ *
+ * Applications using the MEGA API must present a valid application key
+ * and comply with the the rules set forth in the Terms of Service.
+ *
+ * The MEGA SDK is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @copyright Simplified (2-clause) BSD License.
+ *
+ * You should have received a copy of the license along with this
+ * program.
+ */
+
+#ifndef MEGA_THREAD_H
+#define MEGA_THREAD_H 1
+
+#include "types.h"
+
+namespace mega {
+// generic host thread
+struct MEGA_API Thread
+{
+    // start executing the supplied function with the supplied argument
+    virtual void start(void* (*)(void*), void*) = 0;
+
+    // wait for the thread to terminate
+    virtual void join() = 0;
+
+    virtual ~Thread() { }
+};
+
+// generic host mutual exclusion lock
+struct MEGA_API Mutex
+{
+    virtual void lock() = 0;
+    virtual void unlock() = 0;
+
+    virtual ~Mutex() { }
+};
+
+// generic host counting semaphore
+struct MEGA_API Semaphore
+{
+    // increment count, waking up one waiting thread
+    virtual void release() = 0;
+
+    // block until the count is positive, then decrement it
+    virtual void wait() = 0;
+
+    virtual ~Semaphore() { }
+};
+} // namespace
+
+#endif
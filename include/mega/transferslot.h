@@ -25,8 +25,38 @@
 #include "http.h"
 #include "node.h"
 #include "backofftimer.h"
+#include "workerpool.h"
 
 namespace mega {
+// chunk upload preparation (read, MAC, encrypt) or download finalization
+// (decrypt, MAC, write) on a worker thread
+struct MEGA_API TransferChunkJob : public WorkerJob
+{
+    TransferSlot* slot;
+    HttpReqXfer* req;
+
+    // private copy of the transfer key (cipher contexts are not thread-safe)
+    SymmCipher key;
+    int64_t ctriv;
+
+    // chunk range
+    m_off_t pos, npos;
+
+    // resulting chunk MACs
+    chunkmac_map macs;
+
+    bool success;
+    bool done;
+
+    // read retry after transient failure
+    BackoffTimer retrybt;
+
+    void run();
+    void complete(MegaClient*);
+
+    TransferChunkJob(TransferSlot*, HttpReqXfer*, m_off_t, m_off_t);
+};
+
 // active transfer
 struct MEGA_API TransferSlot
 {
@@ -66,6 +96,38 @@ struct MEGA_API TransferSlot
     int connections;
     HttpReqXfer** reqs;
 
+    // per-connection chunk jobs handed to the worker pool
+    TransferChunkJob** jobs;
+
+    // serializes worker thread access to fa
+    Mutex* famutex;
+
+    // number of chunk jobs in progress
+    int asyncjobs() const;
+
+    // consecutive chunks are coalesced into requests of up to reqsize bytes,
+    // sized from the observed throughput and request latency
+    static const m_off_t MAXREQSIZE = 16777216;
+
+    // a request should last at least REQLATENCYFACTOR round trips
+    static const int REQLATENCYFACTOR = 8;
+
+    m_off_t reqsize;
+
+    // smoothed throughput (bytes/ds) and request latency (ds)
+    m_off_t reqspeed;
+    dstime reqlatency;
+
+    // per-connection time of request start and of first data
+    dstime* reqstarted;
+    dstime* reqfirstdata;
+
+    // next request boundary for the given position
+    m_off_t nextreqpos(m_off_t);
+
+    // update request sizing after a completed request
+    void updatereqsize(int);
+
     // handle I/O for this slot
     void doio(MegaClient*);
 
@@ -59,7 +59,9 @@ extern bool debug;
 struct AttrMap;
 class BackoffTimer;
 class Command;
+class DbTable;
 struct FileAccess;
+class FileAttributeCache;
 struct FileAttributeFetch;
 struct FileAttributeFetchChannel;
 struct FileFingerprint;
@@ -83,7 +85,8 @@ struct Waiter;
 #define TOSTRING(x) STRINGIFY(x)
 
 // HttpReq states
-typedef enum { REQ_READY, REQ_PREPARED, REQ_INFLIGHT, REQ_SUCCESS, REQ_FAILURE, REQ_DONE } reqstatus_t;
+// (REQ_ASYNCIO: chunk data is being processed by a worker thread)
+typedef enum { REQ_READY, REQ_PREPARED, REQ_INFLIGHT, REQ_SUCCESS, REQ_FAILURE, REQ_DONE, REQ_ASYNCIO } reqstatus_t;
 
 typedef enum { USER_HANDLE, NODE_HANDLE } targettype_t;
 
@@ -222,6 +225,8 @@ typedef vector<LocalNode*> localnode_vector;
 
 typedef map<handle, LocalNode*> handlelocalnode_map;
 
+typedef map<handle, FileFingerprint> handlefingerprint_map;
+
 typedef list<LocalNode*> localnode_list;
 
 typedef set<LocalNode*> localnode_set;
@@ -234,6 +239,9 @@ typedef set<Node*> node_set;
 // FIXME: switch to forward_list once C++11 becomes more widely available
 typedef list<Node*> node_list;
 
+// indexes a large folder's children by display name
+typedef multimap<string, Node*> namenode_map;
+
 // undefined node handle
 const handle UNDEF = ~(handle)0;
 
@@ -247,9 +255,6 @@ typedef list<HttpReqCommandPutFA*> putfa_list;
 // map a FileFingerprint to the transfer for that FileFingerprint
 typedef map<FileFingerprint*, Transfer*, FileFingerprintCmp> transfer_map;
 
-// maps node handles to Node pointers
-typedef map<handle, Node*> node_map;
-
 // maps node handles to Share pointers
 typedef map<handle, struct Share*> share_map;
 
@@ -333,6 +338,9 @@ typedef deque<Notification> notify_deque;
 
 // FIXME: use forward_list instad (C++11)
 typedef list<HttpReqCommandPutFA*> putfa_list;
+
+// queued file attribute writes, by upload handle
+typedef map<handle, putfa_list> handleputfa_map;
 } // namespace
 
 #endif
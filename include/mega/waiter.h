@@ -61,6 +61,9 @@ struct MEGA_API Waiter
     // specified number of deciseconds
     virtual int wait() = 0;
 
+    // wake up a (possibly blocked) wait() from another thread
+    virtual void notify() { }
+
     static const int NEEDEXEC = 1;
     static const int HAVESTDIN = 2;
 };
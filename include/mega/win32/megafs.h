@@ -107,6 +107,10 @@ class MEGA_API WinFileAccess : public FileAccess
 {
     HANDLE hFile;
 
+    // fmap() file mapping and view
+    HANDLE hMapping;
+    const byte* mapped;
+
 public:
     HANDLE hFind;
     WIN32_FIND_DATAW ffd;
@@ -116,6 +120,7 @@ public:
     bool fread(string *, unsigned, unsigned, m_off_t);
     bool frawread(byte *, unsigned, m_off_t);
     bool fwrite(const byte *, unsigned, m_off_t);
+    const byte* fmap();
 
     bool sysread(byte *, unsigned, m_off_t);
     bool sysstat(m_time_t*, m_off_t*);
@@ -0,0 +1,75 @@
+/**
+ * @file mega/win32/megathread.h
+ * @brief Win32 threading primitives
+ *
+ * (c) 2013-2014 by Mega Limited, Wellsford, New Zealand
+ *
+ * This file is part of the MEGA SDK - Client Access Engine.
+ *
+ * Applications using the MEGA API must present a valid application key
+ * and comply with the the rules set forth in the Terms of Service.
+ *
+ * The MEGA SDK is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @copyright Simplified (2-clause) BSD License.
+ *
+ * You should have received a copy of the license along with this
+ * program.
+ */
+
+#ifndef THREAD_CLASS
+#define THREAD_CLASS WinThread
+#define MUTEX_CLASS WinMutex
+#define SEMAPHORE_CLASS WinSemaphore
+
+#include "mega/thread.h"
+
+namespace mega {
+class MEGA_API WinThread : public Thread
+{
+    HANDLE hThread;
+
+    void* (*entry)(void*);
+    void* arg;
+
+    static DWORD WINAPI run(LPVOID);
+
+public:
+    void start(void* (*)(void*), void*);
+    void join();
+
+    // number of online processor cores
+    static unsigned cores();
+
+    WinThread();
+    ~WinThread();
+};
+
+class MEGA_API WinMutex : public Mutex
+{
+    CRITICAL_SECTION cs;
+
+public:
+    void lock();
+    void unlock();
+
+    WinMutex();
+    ~WinMutex();
+};
+
+class MEGA_API WinSemaphore : public Semaphore
+{
+    HANDLE hSemaphore;
+
+public:
+    void release();
+    void wait();
+
+    WinSemaphore();
+    ~WinSemaphore();
+};
+} // namespace
+
+#endif
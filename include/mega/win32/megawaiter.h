@@ -32,11 +32,16 @@ public:
     PCRITICAL_SECTION pcsHTTP;
     unsigned pendingfsevents;
 
+    // signalled by notify()
+    HANDLE hNotify;
+
     int wait();
+    void notify();
 
     bool addhandle(HANDLE handle, int);
 
     WinWaiter();
+    ~WinWaiter();
 };
 } // namespace
 
@@ -0,0 +1,103 @@
+/**
+ * @file mega/workerpool.h
+ * @brief Worker threads for CPU-intensive engine tasks
+ *
+ * (c) 2013-2014 by Mega Limited, Wellsford, New Zealand
+ *
+ * This file is part of the MEGA SDK - Client Access Engine.
+ *
+ * Applications using the MEGA API must present a valid application key
+ * and comply with the the rules set forth in the Terms of Service.
+ *
+ * The MEGA SDK is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @copyright Simplified (2-clause) BSD License.
+ *
+ * You should have received a copy of the license along with this
+ * program.
+ */
+
+#ifndef MEGA_WORKERPOOL_H
+#define MEGA_WORKERPOOL_H 1
+
+#include "thread.h"
+#include "waiter.h"
+
+namespace mega {
+// unit of work: run() executes on a worker thread and must not touch any
+// engine state that is not owned by the job; complete() is subsequently
+// invoked from MegaClient::exec() and may delete the job
+struct MEGA_API WorkerJob
+{
+    virtual void run() = 0;
+    virtual void complete(MegaClient*) = 0;
+
+    virtual ~WorkerJob() { }
+};
+
+typedef deque<WorkerJob*> workerjob_deque;
+
+class MEGA_API WorkerPool
+{
+    // wakes up the engine when a job has finished
+    Waiter* waiter;
+
+    vector<Thread*> threads;
+
+    // protects pendingq, doneq, abandoned and stopping
+    Mutex* mutex;
+
+    // one token per queued job (plus one per thread on shutdown)
+    Semaphore* queued;
+
+    // signalled when a running job that was canceled has finished
+    Semaphore* canceled;
+
+    workerjob_deque pendingq;
+    workerjob_deque doneq;
+
+    // running jobs that were canceled by the engine
+    set<WorkerJob*> abandoned;
+
+    bool stopping;
+
+    static void* threadentry(void*);
+    void loop();
+
+public:
+    // number of jobs pushed but not yet completed
+    unsigned pending;
+
+    // (re)start with the given number of worker threads (0: jobs are run
+    // synchronously by push(), jobs still queued are run immediately)
+    void start(unsigned);
+
+    // terminate all worker threads (queued jobs are kept)
+    void stop();
+
+    unsigned numthreads() const;
+
+    // queue job for execution
+    void push(WorkerJob*);
+
+    // remove and delete a job that has not completed yet (blocks while the job
+    // is running)
+    void cancel(WorkerJob*);
+
+    // invoke complete() on all finished jobs - returns true if there were any
+    bool exec(MegaClient*);
+
+    // parallel loop over independent jobs: run() is invoked on the worker
+    // threads and on the calling thread, then complete() on the calling
+    // thread in order (blocks until all jobs have run; the jobs are not
+    // deleted)
+    void runbatch(vector<WorkerJob*>*, MegaClient*);
+
+    WorkerPool(Waiter*);
+    ~WorkerPool();
+};
+} // namespace
+
+#endif
@@ -22,6 +22,67 @@
 #include "mega/attrmap.h"
 
 namespace mega {
+AttrVector::iterator AttrVector::lowerbound(nameid name)
+{
+    iterator lo = v.begin();
+    size_t n = v.size();
+
+    while (n)
+    {
+        size_t half = n / 2;
+
+        if (lo[half].first < name)
+        {
+            lo += half + 1;
+            n -= half + 1;
+        }
+        else
+        {
+            n = half;
+        }
+    }
+
+    return lo;
+}
+
+AttrVector::iterator AttrVector::find(nameid name)
+{
+    iterator it = lowerbound(name);
+
+    return (it != v.end() && it->first == name) ? it : v.end();
+}
+
+AttrVector::const_iterator AttrVector::find(nameid name) const
+{
+    return const_iterator(const_cast<AttrVector*>(this)->find(name));
+}
+
+string& AttrVector::operator[](nameid name)
+{
+    iterator it = lowerbound(name);
+
+    if (it == v.end() || it->first != name)
+    {
+        it = v.insert(it, value_type(name, string()));
+    }
+
+    return it->second;
+}
+
+size_t AttrVector::erase(nameid name)
+{
+    iterator it = find(name);
+
+    if (it == v.end())
+    {
+        return 0;
+    }
+
+    v.erase(it);
+
+    return 1;
+}
+
 // approximate raw storage size of serialized AttrMap, not taking JSON escaping
 // or name length into account
 unsigned AttrMap::storagesize(int perrecord) const
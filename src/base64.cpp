@@ -21,73 +21,166 @@
 
 #include "mega/base64.h"
 
+// SSSE3 block decoder (x86/x64 only, selected at runtime)
+#if (defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)) \
+    && (defined(_MSC_VER) || defined(__clang__) || (defined(__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))))
+#define MEGA_BASE64SSSE3 1
+#include <tmmintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define SSSE3_TARGET
+#else
+#define SSSE3_TARGET __attribute__((target("ssse3")))
+#endif
+#endif
+
 namespace mega {
 // modified base64 conversion (no trailing '=' and '-_' instead of '+/')
+const char Base64::alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+
+// character to sextet (255: not part of the alphabet)
+const byte Base64::values[256] = {
+    255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+    255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+    255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,  62, 255, 255,
+     52,  53,  54,  55,  56,  57,  58,  59,  60,  61, 255, 255, 255, 255, 255, 255,
+    255,   0,   1,   2,   3,   4,   5,   6,   7,   8,   9,  10,  11,  12,  13,  14,
+     15,  16,  17,  18,  19,  20,  21,  22,  23,  24,  25, 255, 255, 255, 255,  63,
+    255,  26,  27,  28,  29,  30,  31,  32,  33,  34,  35,  36,  37,  38,  39,  40,
+     41,  42,  43,  44,  45,  46,  47,  48,  49,  50,  51, 255, 255, 255, 255, 255,
+    255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+    255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+    255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+    255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+    255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+    255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+    255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+    255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255
+};
+
 unsigned char Base64::to64(byte c)
 {
-    c &= 63;
- 
-    if (c < 26)
-    {
-        return c + 'A';
-    }
- 
-    if (c < 52)
-    {
-        return c - 26 + 'a';
-    }
-
-    if (c < 62)
-    {
-        return c - 52 + '0';
-    }
-
-    if (c == 62)
-    {
-        return '-';
-    }
-
-    return '_';
+    return alphabet[c & 63];
 }
 
 unsigned char Base64::from64(byte c)
 {
-    if ((c >= 'A') && (c <= 'Z'))
-    {
-        return c - 'A';
-    }
+    return values[c];
+}
 
-    if ((c >= 'a') && (c <= 'z'))
-    {
-        return c - 'a' + 26;
-    }
+#ifdef MEGA_BASE64SSSE3
+// decode 16 characters to 12 bytes - returns false without output if any of
+// them is not part of the alphabet
+SSSE3_TARGET static bool atob16(const char* a, byte* b)
+{
+    __m128i v = _mm_loadu_si128((const __m128i*)a);
 
-    if ((c >= '0') && (c <= '9'))
-    {
-        return c - '0' + 52;
-    }
+    // classify: A-Z, a-z, 0-9, '-', '_' (bytes >= 0x80 compare as negative)
+    __m128i upper = _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8('A' - 1)),
+                                  _mm_cmplt_epi8(v, _mm_set1_epi8('Z' + 1)));
+    __m128i lower = _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8('a' - 1)),
+                                  _mm_cmplt_epi8(v, _mm_set1_epi8('z' + 1)));
+    __m128i digit = _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8('0' - 1)),
+                                  _mm_cmplt_epi8(v, _mm_set1_epi8('9' + 1)));
+    __m128i dash = _mm_cmpeq_epi8(v, _mm_set1_epi8('-'));
+    __m128i underscore = _mm_cmpeq_epi8(v, _mm_set1_epi8('_'));
 
-    if (c == '-')
-    {
-        return 62;
-    }
+    __m128i valid = _mm_or_si128(_mm_or_si128(upper, lower), _mm_or_si128(_mm_or_si128(digit, dash), underscore));
 
-    if (c == '_')
+    if (_mm_movemask_epi8(valid) != 0xffff)
     {
-        return 63;
+        return false;
     }
 
-    return 255;
+    // translate to sextets
+    __m128i shift = _mm_or_si128(_mm_or_si128(_mm_and_si128(upper, _mm_set1_epi8(-'A')),
+                                              _mm_and_si128(lower, _mm_set1_epi8(26 - 'a'))),
+                                 _mm_or_si128(_mm_or_si128(_mm_and_si128(digit, _mm_set1_epi8(52 - '0')),
+                                                           _mm_and_si128(dash, _mm_set1_epi8(62 - '-'))),
+                                              _mm_and_si128(underscore, _mm_set1_epi8(63 - '_'))));
+
+    v = _mm_add_epi8(v, shift);
+
+    // merge four sextets into 24 bits per 32-bit lane, then compact
+    v = _mm_maddubs_epi16(v, _mm_set1_epi32(0x01400140));
+    v = _mm_madd_epi16(v, _mm_set1_epi32(0x00011000));
+    v = _mm_shuffle_epi8(v, _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1));
+
+    int32_t tail = _mm_cvtsi128_si32(_mm_srli_si128(v, 8));
+
+    _mm_storel_epi64((__m128i*)b, v);
+    memcpy(b + 8, &tail, sizeof tail);
+
+    return true;
+}
+
+static bool ssse3supported()
+{
+#ifdef _MSC_VER
+    int info[4];
+
+    __cpuid(info, 1);
+
+    return (info[2] & (1 << 9)) != 0;
+#else
+    __builtin_cpu_init();
+
+    return __builtin_cpu_supports("ssse3") != 0;
+#endif
 }
 
+bool Base64::usessse3 = ssse3supported();
+#else
+bool Base64::usessse3 = false;
+#endif
+
 int Base64::atob(const char* a, byte* b, int blen)
 {
     byte c[4];
     int i;
     int p = 0;
 
+    // the block decoders must not read past the terminator (no more than
+    // the output can take is looked at)
+    size_t n = blen > 0 ? strnlen(a, (blen + 2) / 3 * 4) : 0;
+
+#ifdef MEGA_BASE64SSSE3
+    if (usessse3)
+    {
+        // 16 characters at a time while they are valid and the output fits
+        while (n >= 16 && blen - p >= 12 && atob16(a, b + p))
+        {
+            a += 16;
+            n -= 16;
+            p += 12;
+        }
+    }
+#endif
+
+    // complete groups of four characters
+    while (n >= 4 && blen - p >= 3)
+    {
+        byte c0 = values[(byte)a[0]];
+        byte c1 = values[(byte)a[1]];
+        byte c2 = values[(byte)a[2]];
+        byte c3 = values[(byte)a[3]];
+
+        if ((c0 | c1 | c2 | c3) & 0x80)
+        {
+            break;
+        }
+
+        b[p++] = (c0 << 2) | (c1 >> 4);
+        b[p++] = (c1 << 4) | (c2 >> 2);
+        b[p++] = (c2 << 6) | c3;
+
+        a += 4;
+        n -= 4;
+    }
+
     c[3] = 0;
 
+    // trailing partial group or truncated output
     for (;;)
     {
         for (i = 0; i < 4; i++)
@@ -127,32 +220,24 @@ int Base64::btoa(const byte* b, int blen, char* a)
 {
     int p = 0;
 
-    for (;;)
+    // complete groups of three bytes
+    for (; blen >= 3; blen -= 3, b += 3)
     {
-        if (blen <= 0)
-        {
-            break;
-        }
-
-        a[p++] = to64(*b >> 2);
-        a[p++] = to64((*b << 4) | (((blen > 1) ? b[1] : 0) >> 4));
-
-        if (blen < 2)
-        {
-            break;
-        }
+        a[p++] = alphabet[b[0] >> 2];
+        a[p++] = alphabet[((b[0] << 4) | (b[1] >> 4)) & 63];
+        a[p++] = alphabet[((b[1] << 2) | (b[2] >> 6)) & 63];
+        a[p++] = alphabet[b[2] & 63];
+    }
 
-        a[p++] = to64(b[1] << 2 | (((blen > 2) ? b[2] : 0) >> 6));
+    if (blen > 0)
+    {
+        a[p++] = alphabet[b[0] >> 2];
+        a[p++] = alphabet[((b[0] << 4) | (((blen > 1) ? b[1] : 0) >> 4)) & 63];
 
-        if (blen < 3)
+        if (blen > 1)
         {
-            break;
+            a[p++] = alphabet[(b[1] << 2) & 63];
         }
-
-        a[p++] = to64(b[2]);
-
-        blen -= 3;
-        b += 3;
     }
 
     a[p] = 0;
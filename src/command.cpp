@@ -26,6 +26,7 @@ namespace mega {
 Command::Command()
 {
     persistent = false;
+    incremental = false;
     level = -1;
     canceled = false;
 }
@@ -516,7 +516,7 @@ CommandSetAttr::CommandSetAttr(MegaClient* client, Node* n)
     string at;
 
     n->attrs.getjson(&at);
-    client->makeattr(&n->key, &at, at.c_str(), at.size());
+    client->makeattr(n->nodecipher(), &at, at.c_str(), at.size());
 
     arg("n", (byte*)&n->nodehandle, MegaClient::NODEHANDLE);
     arg("at", (byte*)at.c_str(), at.size());
@@ -2189,9 +2189,76 @@ CommandFetchNodes::CommandFetchNodes(MegaClient* client)
     arg("c", "1", 0);
     arg("r", "1", 0);
 
+    incremental = true;
+
     tag = client->reqtag;
 }
 
+// create the nodes of the leading "f" array as they arrive and purge them
+// from the response buffer, leaving an empty array for procresult()
+void CommandFetchNodes::procpartial(HttpReq* req)
+{
+    static const char prefix[] = "[{\"f\":[";
+    const size_t start = sizeof prefix - 1;
+
+    if (req->in.size() <= start || memcmp(req->in.data(), prefix, start))
+    {
+        return;
+    }
+
+    // locate the end of the last complete element received
+    const char* ptr = req->in.c_str() + start;
+    const char* end = ptr;
+    JSON j;
+
+    j.begin(ptr);
+
+    while ((*j.pos == '{' || (*j.pos == ',' && j.pos[1] == '{')) && j.storeobject())
+    {
+        end = j.pos;
+    }
+
+    if (end == ptr)
+    {
+        return;
+    }
+
+    // (a separator left over from the previous round is skipped)
+    string elements("[");
+    elements.append(ptr + (*ptr == ','), end - ptr - (*ptr == ','));
+    elements.append("]");
+
+    node_vector added;
+
+    j.begin(elements.c_str());
+
+    if (!client->readnodes(&j, 0, PUTNODES_APP, NULL, 0, &added))
+    {
+        // left to procresult() for error handling
+        return;
+    }
+
+    req->in.erase(start, end - ptr);
+
+    for (node_vector::iterator it = added.begin(); it != added.end(); it++)
+    {
+        if (!(*it)->parent && !ISUNDEF((*it)->parenthandle))
+        {
+            orphans.push_back(*it);
+        }
+    }
+
+    // nodes under the master key can be decrypted right away
+    client->applykeys(&added);
+}
+
+// the retried request delivers all nodes again
+void CommandFetchNodes::cancelpartial()
+{
+    orphans.clear();
+    client->purgenodes();
+}
+
 // purge and rebuild node/user tree
 void CommandFetchNodes::procresult()
 {
@@ -2212,6 +2279,19 @@ void CommandFetchNodes::procresult()
                 {
                     return client->app->fetchnodes_result(API_EINTERNAL);
                 }
+
+                // link nodes that were streamed in before their parents
+                for (node_vector::iterator it = orphans.begin(); it != orphans.end(); it++)
+                {
+                    Node* p;
+
+                    if (!(*it)->parent && (p = client->nodebyhandle((*it)->parenthandle)))
+                    {
+                        (*it)->setparent(p);
+                    }
+                }
+
+                orphans.clear();
                 break;
 
             case MAKENAMEID2('o', 'k'):
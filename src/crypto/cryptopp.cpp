@@ -21,6 +21,32 @@
 
 #include "mega.h"
 
+// AES-NI accelerated ctr_crypt() kernel (x86/x64 only, selected at runtime)
+#if (defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)) \
+    && (defined(_MSC_VER) || defined(__clang__) || (defined(__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))))
+#define MEGA_AESNI 1
+#include <wmmintrin.h>
+#include <emmintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define AESNI_TARGET
+#else
+#include <cpuid.h>
+#define AESNI_TARGET __attribute__((target("aes,sse2")))
+#endif
+#endif
+
+// PCLMUL accelerated CRC32 (same CPU/compiler requirements)
+#ifdef MEGA_AESNI
+#define MEGA_PCLMUL 1
+#include <smmintrin.h>
+#ifdef _MSC_VER
+#define PCLMUL_TARGET
+#else
+#define PCLMUL_TARGET __attribute__((target("pclmul,sse4.1")))
+#endif
+#endif
+
 namespace mega {
 #ifndef htobe64
 #define htobe64(x) (((uint64_t)htonl((uint32_t)((x) >> 32))) | (((uint64_t)htonl((uint32_t)x)) << 32))
@@ -139,6 +165,190 @@ void SymmCipher::incblock(byte* dst, unsigned len)
     }
 }
 
+#ifdef MEGA_AESNI
+static bool aesnisupported()
+{
+#ifdef _MSC_VER
+    int info[4];
+
+    __cpuid(info, 1);
+
+    return (info[2] & (1 << 25)) && (info[3] & (1 << 26));
+#else
+    unsigned eax, ebx, ecx, edx;
+
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx))
+    {
+        return false;
+    }
+
+    return (ecx & bit_AES) && (edx & bit_SSE2);
+#endif
+}
+
+bool SymmCipher::useaesni = aesnisupported();
+
+// AES-128 key expansion step
+#define AESNI_EXPAND(k, rcon) aesni_expandstep(k, _mm_aeskeygenassist_si128(k, rcon))
+
+static inline AESNI_TARGET __m128i aesni_expandstep(__m128i k, __m128i t)
+{
+    t = _mm_shuffle_epi32(t, 0xff);
+    k = _mm_xor_si128(k, _mm_slli_si128(k, 4));
+    k = _mm_xor_si128(k, _mm_slli_si128(k, 4));
+    k = _mm_xor_si128(k, _mm_slli_si128(k, 4));
+
+    return _mm_xor_si128(k, t);
+}
+
+// increment the 128-bit big-endian counter held in two host-order halves
+static inline void aesni_incctr(uint64_t* ctrhi, uint64_t* ctrlo)
+{
+    if (!++*ctrlo)
+    {
+        ++*ctrhi;
+    }
+}
+
+static inline AESNI_TARGET __m128i aesni_ctrblock(uint64_t ctrhi, uint64_t ctrlo)
+{
+    byte b[SymmCipher::BLOCKSIZE];
+
+    for (int i = 8; i--; )
+    {
+        b[i] = (byte)(ctrhi >> (8 * (7 - i)));
+        b[i + 8] = (byte)(ctrlo >> (8 * (7 - i)));
+    }
+
+    return _mm_loadu_si128((const __m128i*)b);
+}
+
+// CTR keystream generation for BATCH counter blocks runs interleaved with the
+// serial CBC-MAC: while the MAC of block j of the current batch is computed,
+// the keystream of block j of the next batch is encrypted alongside it, so
+// the CTR work hides entirely in the latency shadow of the MAC chain
+static AESNI_TARGET void aesni_ctr_crypt(const byte* key, byte* data, unsigned len, const byte* ctr, byte* mac, int encrypt)
+{
+    static const int BATCH = 4;
+    __m128i rk[11];
+
+    rk[0] = _mm_loadu_si128((const __m128i*)key);
+    rk[1] = AESNI_EXPAND(rk[0], 0x01);
+    rk[2] = AESNI_EXPAND(rk[1], 0x02);
+    rk[3] = AESNI_EXPAND(rk[2], 0x04);
+    rk[4] = AESNI_EXPAND(rk[3], 0x08);
+    rk[5] = AESNI_EXPAND(rk[4], 0x10);
+    rk[6] = AESNI_EXPAND(rk[5], 0x20);
+    rk[7] = AESNI_EXPAND(rk[6], 0x40);
+    rk[8] = AESNI_EXPAND(rk[7], 0x80);
+    rk[9] = AESNI_EXPAND(rk[8], 0x1b);
+    rk[10] = AESNI_EXPAND(rk[9], 0x36);
+
+    uint64_t ctrhi = 0, ctrlo = 0;
+
+    for (int i = 0; i < 8; i++)
+    {
+        ctrhi = (ctrhi << 8) | ctr[i];
+        ctrlo = (ctrlo << 8) | ctr[i + 8];
+    }
+
+    __m128i m = _mm_loadu_si128((const __m128i*)mac);
+    __m128i ks[BATCH], nks[BATCH];
+    unsigned blocks = (len + SymmCipher::BLOCKSIZE - 1) / SymmCipher::BLOCKSIZE;
+    int i, r;
+
+    // prologue: keystream for the first batch
+    for (i = 0; i < BATCH; i++)
+    {
+        ks[i] = _mm_xor_si128(aesni_ctrblock(ctrhi, ctrlo), rk[0]);
+        aesni_incctr(&ctrhi, &ctrlo);
+    }
+
+    for (r = 1; r < 10; r++)
+    {
+        for (i = 0; i < BATCH; i++)
+        {
+            ks[i] = _mm_aesenc_si128(ks[i], rk[r]);
+        }
+    }
+
+    for (i = 0; i < BATCH; i++)
+    {
+        ks[i] = _mm_aesenclast_si128(ks[i], rk[10]);
+    }
+
+    while (blocks)
+    {
+        unsigned n = blocks < (unsigned)BATCH ? blocks : BATCH;
+        __m128i* d = (__m128i*)data;
+
+        for (i = 0; i < BATCH; i++)
+        {
+            __m128i p;
+
+            // keystream for the next batch (also computed past the end - harmless)
+            nks[i] = _mm_xor_si128(aesni_ctrblock(ctrhi, ctrlo), rk[0]);
+            aesni_incctr(&ctrhi, &ctrlo);
+
+            if ((unsigned)i >= n)
+            {
+                for (r = 1; r < 10; r++)
+                {
+                    nks[i] = _mm_aesenc_si128(nks[i], rk[r]);
+                }
+
+                nks[i] = _mm_aesenclast_si128(nks[i], rk[10]);
+                continue;
+            }
+
+            if (encrypt)
+            {
+                p = _mm_loadu_si128(d + i);
+                _mm_storeu_si128(d + i, _mm_xor_si128(p, ks[i]));
+            }
+            else
+            {
+                p = _mm_xor_si128(_mm_loadu_si128(d + i), ks[i]);
+                _mm_storeu_si128(d + i, p);
+
+                if (len < (unsigned)SymmCipher::BLOCKSIZE * (i + 1))
+                {
+                    // trailing partial block: only MAC the actual payload
+                    byte t[SymmCipher::BLOCKSIZE] = { 0 };
+
+                    memcpy(t, data + SymmCipher::BLOCKSIZE * i, len - SymmCipher::BLOCKSIZE * i);
+                    p = _mm_loadu_si128((const __m128i*)t);
+                }
+            }
+
+            m = _mm_xor_si128(_mm_xor_si128(m, p), rk[0]);
+
+            for (r = 1; r < 10; r++)
+            {
+                m = _mm_aesenc_si128(m, rk[r]);
+                nks[i] = _mm_aesenc_si128(nks[i], rk[r]);
+            }
+
+            m = _mm_aesenclast_si128(m, rk[10]);
+            nks[i] = _mm_aesenclast_si128(nks[i], rk[10]);
+        }
+
+        for (i = 0; i < BATCH; i++)
+        {
+            ks[i] = nks[i];
+        }
+
+        blocks -= n;
+        data += n * SymmCipher::BLOCKSIZE;
+        len -= len < n * SymmCipher::BLOCKSIZE ? len : n * SymmCipher::BLOCKSIZE;
+    }
+
+    _mm_storeu_si128((__m128i*)mac, m);
+}
+#else
+bool SymmCipher::useaesni = false;
+#endif
+
 // encryption: data must be NUL-padded to BLOCKSIZE
 // decryption: data must be padded to BLOCKSIZE
 // len must be < 2^31
@@ -154,6 +364,14 @@ void SymmCipher::ctr_crypt(byte* data, unsigned len, m_off_t pos, ctr_iv ctriv,
     memcpy(mac, ctr, sizeof ctriv);
     memcpy(mac + sizeof ctriv, ctr, sizeof ctriv);
 
+#ifdef MEGA_AESNI
+    if (useaesni)
+    {
+        return aesni_ctr_crypt(key, data, len, ctr, mac, encrypt);
+    }
+#endif
+
+    // portable fallback
     while ((int)len > 0)
     {
         if (encrypt)
@@ -432,13 +650,208 @@ void Hash::get(string* out)
     hash.Final((byte*)out->data());
 }
 
+// CRC32 (IEEE 802.3, reflected) byte-at-a-time table for the PCLMUL path's
+// unaligned head and tail
+static const uint32_t crc32table[256] = {
+    0x00000000, 0x77073096, 0xee0e612c, 0x990951ba, 0x076dc419, 0x706af48f,
+    0xe963a535, 0x9e6495a3, 0x0edb8832, 0x79dcb8a4, 0xe0d5e91e, 0x97d2d988,
+    0x09b64c2b, 0x7eb17cbd, 0xe7b82d07, 0x90bf1d91, 0x1db71064, 0x6ab020f2,
+    0xf3b97148, 0x84be41de, 0x1adad47d, 0x6ddde4eb, 0xf4d4b551, 0x83d385c7,
+    0x136c9856, 0x646ba8c0, 0xfd62f97a, 0x8a65c9ec, 0x14015c4f, 0x63066cd9,
+    0xfa0f3d63, 0x8d080df5, 0x3b6e20c8, 0x4c69105e, 0xd56041e4, 0xa2677172,
+    0x3c03e4d1, 0x4b04d447, 0xd20d85fd, 0xa50ab56b, 0x35b5a8fa, 0x42b2986c,
+    0xdbbbc9d6, 0xacbcf940, 0x32d86ce3, 0x45df5c75, 0xdcd60dcf, 0xabd13d59,
+    0x26d930ac, 0x51de003a, 0xc8d75180, 0xbfd06116, 0x21b4f4b5, 0x56b3c423,
+    0xcfba9599, 0xb8bda50f, 0x2802b89e, 0x5f058808, 0xc60cd9b2, 0xb10be924,
+    0x2f6f7c87, 0x58684c11, 0xc1611dab, 0xb6662d3d, 0x76dc4190, 0x01db7106,
+    0x98d220bc, 0xefd5102a, 0x71b18589, 0x06b6b51f, 0x9fbfe4a5, 0xe8b8d433,
+    0x7807c9a2, 0x0f00f934, 0x9609a88e, 0xe10e9818, 0x7f6a0dbb, 0x086d3d2d,
+    0x91646c97, 0xe6635c01, 0x6b6b51f4, 0x1c6c6162, 0x856530d8, 0xf262004e,
+    0x6c0695ed, 0x1b01a57b, 0x8208f4c1, 0xf50fc457, 0x65b0d9c6, 0x12b7e950,
+    0x8bbeb8ea, 0xfcb9887c, 0x62dd1ddf, 0x15da2d49, 0x8cd37cf3, 0xfbd44c65,
+    0x4db26158, 0x3ab551ce, 0xa3bc0074, 0xd4bb30e2, 0x4adfa541, 0x3dd895d7,
+    0xa4d1c46d, 0xd3d6f4fb, 0x4369e96a, 0x346ed9fc, 0xad678846, 0xda60b8d0,
+    0x44042d73, 0x33031de5, 0xaa0a4c5f, 0xdd0d7cc9, 0x5005713c, 0x270241aa,
+    0xbe0b1010, 0xc90c2086, 0x5768b525, 0x206f85b3, 0xb966d409, 0xce61e49f,
+    0x5edef90e, 0x29d9c998, 0xb0d09822, 0xc7d7a8b4, 0x59b33d17, 0x2eb40d81,
+    0xb7bd5c3b, 0xc0ba6cad, 0xedb88320, 0x9abfb3b6, 0x03b6e20c, 0x74b1d29a,
+    0xead54739, 0x9dd277af, 0x04db2615, 0x73dc1683, 0xe3630b12, 0x94643b84,
+    0x0d6d6a3e, 0x7a6a5aa8, 0xe40ecf0b, 0x9309ff9d, 0x0a00ae27, 0x7d079eb1,
+    0xf00f9344, 0x8708a3d2, 0x1e01f268, 0x6906c2fe, 0xf762575d, 0x806567cb,
+    0x196c3671, 0x6e6b06e7, 0xfed41b76, 0x89d32be0, 0x10da7a5a, 0x67dd4acc,
+    0xf9b9df6f, 0x8ebeeff9, 0x17b7be43, 0x60b08ed5, 0xd6d6a3e8, 0xa1d1937e,
+    0x38d8c2c4, 0x4fdff252, 0xd1bb67f1, 0xa6bc5767, 0x3fb506dd, 0x48b2364b,
+    0xd80d2bda, 0xaf0a1b4c, 0x36034af6, 0x41047a60, 0xdf60efc3, 0xa867df55,
+    0x316e8eef, 0x4669be79, 0xcb61b38c, 0xbc66831a, 0x256fd2a0, 0x5268e236,
+    0xcc0c7795, 0xbb0b4703, 0x220216b9, 0x5505262f, 0xc5ba3bbe, 0xb2bd0b28,
+    0x2bb45a92, 0x5cb36a04, 0xc2d7ffa7, 0xb5d0cf31, 0x2cd99e8b, 0x5bdeae1d,
+    0x9b64c2b0, 0xec63f226, 0x756aa39c, 0x026d930a, 0x9c0906a9, 0xeb0e363f,
+    0x72076785, 0x05005713, 0x95bf4a82, 0xe2b87a14, 0x7bb12bae, 0x0cb61b38,
+    0x92d28e9b, 0xe5d5be0d, 0x7cdcefb7, 0x0bdbdf21, 0x86d3d2d4, 0xf1d4e242,
+    0x68ddb3f8, 0x1fda836e, 0x81be16cd, 0xf6b9265b, 0x6fb077e1, 0x18b74777,
+    0x88085ae6, 0xff0f6a70, 0x66063bca, 0x11010b5c, 0x8f659eff, 0xf862ae69,
+    0x616bffd3, 0x166ccf45, 0xa00ae278, 0xd70dd2ee, 0x4e048354, 0x3903b3c2,
+    0xa7672661, 0xd06016f7, 0x4969474d, 0x3e6e77db, 0xaed16a4a, 0xd9d65adc,
+    0x40df0b66, 0x37d83bf0, 0xa9bcae53, 0xdebb9ec5, 0x47b2cf7f, 0x30b5ffe9,
+    0xbdbdf21c, 0xcabac28a, 0x53b39330, 0x24b4a3a6, 0xbad03605, 0xcdd70693,
+    0x54de5729, 0x23d967bf, 0xb3667a2e, 0xc4614ab8, 0x5d681b02, 0x2a6f2b94,
+    0xb40bbe37, 0xc30c8ea1, 0x5a05df1b, 0x2d02ef8d
+};
+
+#ifdef MEGA_PCLMUL
+static bool pclmulsupported()
+{
+#ifdef _MSC_VER
+    int info[4];
+
+    __cpuid(info, 1);
+
+    return (info[2] & (1 << 1)) && (info[2] & (1 << 19));
+#else
+    unsigned eax, ebx, ecx, edx;
+
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx))
+    {
+        return false;
+    }
+
+    return (ecx & bit_PCLMUL) && (ecx & bit_SSE4_1);
+#endif
+}
+
+bool HashCRC32::usepclmul = pclmulsupported();
+
+// fold len bytes (len >= 64, multiple of 16) into the CRC register using
+// carry-less multiplication and reduce with Barrett's method (constants for
+// the bit-reflected CRC32 polynomial, Intel "Fast CRC Computation for Generic
+// Polynomials Using PCLMULQDQ Instruction")
+static PCLMUL_TARGET uint32_t pclmul_crc32(const byte* buf, unsigned len, uint32_t crc)
+{
+    const __m128i k1k2 = _mm_set_epi32(0x00000001, 0xc6e41596, 0x00000001, 0x54442bd4);
+    const __m128i k3k4 = _mm_set_epi32(0x00000000, 0xccaa009e, 0x00000001, 0x751997d0);
+    const __m128i k5k0 = _mm_set_epi32(0x00000000, 0x00000000, 0x00000001, 0x63cd6124);
+    const __m128i poly = _mm_set_epi32(0x00000001, 0xf7011641, 0x00000001, 0xdb710641);
+    const __m128i mask32 = _mm_setr_epi32(~0, 0, ~0, 0);
+
+    __m128i x1 = _mm_loadu_si128((const __m128i*)buf);
+    __m128i x2 = _mm_loadu_si128((const __m128i*)(buf + 16));
+    __m128i x3 = _mm_loadu_si128((const __m128i*)(buf + 32));
+    __m128i x4 = _mm_loadu_si128((const __m128i*)(buf + 48));
+    __m128i t1, t2, t3, t4;
+
+    x1 = _mm_xor_si128(x1, _mm_cvtsi32_si128(crc));
+
+    buf += 64;
+    len -= 64;
+
+    // fold four lanes in parallel
+    while (len >= 64)
+    {
+        t1 = _mm_clmulepi64_si128(x1, k1k2, 0x00);
+        t2 = _mm_clmulepi64_si128(x2, k1k2, 0x00);
+        t3 = _mm_clmulepi64_si128(x3, k1k2, 0x00);
+        t4 = _mm_clmulepi64_si128(x4, k1k2, 0x00);
+
+        x1 = _mm_clmulepi64_si128(x1, k1k2, 0x11);
+        x2 = _mm_clmulepi64_si128(x2, k1k2, 0x11);
+        x3 = _mm_clmulepi64_si128(x3, k1k2, 0x11);
+        x4 = _mm_clmulepi64_si128(x4, k1k2, 0x11);
+
+        x1 = _mm_xor_si128(_mm_xor_si128(x1, t1), _mm_loadu_si128((const __m128i*)buf));
+        x2 = _mm_xor_si128(_mm_xor_si128(x2, t2), _mm_loadu_si128((const __m128i*)(buf + 16)));
+        x3 = _mm_xor_si128(_mm_xor_si128(x3, t3), _mm_loadu_si128((const __m128i*)(buf + 32)));
+        x4 = _mm_xor_si128(_mm_xor_si128(x4, t4), _mm_loadu_si128((const __m128i*)(buf + 48)));
+
+        buf += 64;
+        len -= 64;
+    }
+
+    // fold the lanes into one
+    t1 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+    x1 = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x1, k3k4, 0x11), x2), t1);
+    t1 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+    x1 = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x1, k3k4, 0x11), x3), t1);
+    t1 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+    x1 = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x1, k3k4, 0x11), x4), t1);
+
+    // remaining 16-byte blocks
+    while (len >= 16)
+    {
+        t1 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+        x1 = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x1, k3k4, 0x11),
+                                         _mm_loadu_si128((const __m128i*)buf)), t1);
+
+        buf += 16;
+        len -= 16;
+    }
+
+    // 128 -> 64 bits
+    x2 = _mm_clmulepi64_si128(x1, k3k4, 0x10);
+    x1 = _mm_xor_si128(_mm_srli_si128(x1, 8), x2);
+
+    x2 = _mm_srli_si128(x1, 4);
+    x1 = _mm_xor_si128(_mm_clmulepi64_si128(_mm_and_si128(x1, mask32), k5k0, 0x00), x2);
+
+    // Barrett reduction to 32 bits
+    x2 = _mm_clmulepi64_si128(_mm_and_si128(x1, mask32), poly, 0x10);
+    x2 = _mm_clmulepi64_si128(_mm_and_si128(x2, mask32), poly, 0x00);
+    x1 = _mm_xor_si128(x1, x2);
+
+    return _mm_extract_epi32(x1, 1);
+}
+#else
+bool HashCRC32::usepclmul = false;
+#endif
+
+HashCRC32::HashCRC32()
+{
+    crc = 0xffffffff;
+}
+
 void HashCRC32::add(const byte* data, unsigned len)
 {
-    hash.Update(data, len);
+    if (usepclmul)
+    {
+#ifdef MEGA_PCLMUL
+        if (len >= 64)
+        {
+            unsigned bulk = len & ~15U;
+
+            crc = pclmul_crc32(data, bulk, crc);
+
+            data += bulk;
+            len -= bulk;
+        }
+#endif
+
+        while (len--)
+        {
+            crc = crc32table[(crc ^ *data++) & 0xff] ^ (crc >> 8);
+        }
+    }
+    else
+    {
+        hash.Update(data, len);
+    }
 }
 
+// (the CRC is output in little-endian byte order, like Crypto++ on x86)
 void HashCRC32::get(byte* out)
 {
-    hash.Final(out);
+    if (usepclmul)
+    {
+        crc = ~crc;
+
+        out[0] = (byte)crc;
+        out[1] = (byte)(crc >> 8);
+        out[2] = (byte)(crc >> 16);
+        out[3] = (byte)(crc >> 24);
+
+        crc = 0xffffffff;
+    }
+    else
+    {
+        hash.Final(out);
+    }
 }
 } // namespace
@@ -48,13 +48,18 @@ bool DbTable::put(uint32_t type, Cachable* record, SymmCipher* key)
 
     if (!record->dbid)
     {
-        record->dbid = (nextid += IDSPACING) | type;
+        record->dbid = newid(type);
     }
 
     return put(record->dbid, &data);
 }
 
-// get next record, decrypt and unpad
+uint32_t DbTable::newid(uint32_t type)
+{
+    return (nextid += IDSPACING) | type;
+}
+
+// get next record, decrypt and unpad (NULL key: leave encrypted)
 bool DbTable::next(uint32_t* type, string* data, SymmCipher* key)
 {
     if (next(type, data))
@@ -69,7 +74,7 @@ bool DbTable::next(uint32_t* type, string* data, SymmCipher* key)
             nextid = *type & - IDSPACING;
         }
 
-        return PaddedCBC::decrypt(data, key);
+        return !key || PaddedCBC::decrypt(data, key);
     }
 
     return false;
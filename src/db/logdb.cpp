@@ -0,0 +1,670 @@
+/**
+ * @file logdb.cpp
+ * @brief Append-only log/snapshot DB access layer
+ *
+ * (c) 2013-2014 by Mega Limited, Wellsford, New Zealand
+ *
+ * This file is part of the MEGA SDK - Client Access Engine.
+ *
+ * Applications using the MEGA API must present a valid application key
+ * and comply with the the rules set forth in the Terms of Service.
+ *
+ * The MEGA SDK is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @copyright Simplified (2-clause) BSD License.
+ *
+ * You should have received a copy of the license along with this
+ * program.
+ */
+
+// file formats (native byte order):
+// record: 32-bit id, 32-bit length, data
+// snapshot: 8-byte magic, 32-bit record count, 32-bit padding, records in
+// ascending id order
+// log: transactions, each consisting of put records, deletion records
+// (length DELETED), truncation records (length TRUNCATED) and a final commit
+// record (length COMMITTED) carrying the checksum of the transaction as its
+// id - an incomplete or corrupt transaction ends the log
+
+#include "mega/db/logdb.h"
+#include "mega/filesystem.h"
+
+namespace mega {
+static const char SNAPSHOTMAGIC[] = "MEGASNP1";
+
+LogDbAccess::LogDbAccess(string* path)
+{
+    if (path)
+    {
+        dbpath = *path;
+    }
+}
+
+DbTable* LogDbAccess::open(FileSystemAccess* fsaccess, string* name)
+{
+    string dbname = dbpath + "megaclient_statecache_" + *name;
+    LogDbTable* table = new LogDbTable(fsaccess);
+
+    if (!table->load(&dbname))
+    {
+        delete table;
+        return NULL;
+    }
+
+    return table;
+}
+
+LogDbTable::LogDbTable(FileSystemAccess* fs)
+{
+    fsaccess = fs;
+    snapshotfa = NULL;
+    snapshot = NULL;
+    snapshotsize = 0;
+    logfa = NULL;
+    logsize = 0;
+    compactlogsize = MINCOMPACTSIZE;
+    intxn = false;
+    failed = false;
+
+    rewind();
+}
+
+LogDbTable::~LogDbTable()
+{
+    abort();
+
+    delete logfa;
+    delete snapshotfa;
+}
+
+// open snapshot and log, replay committed transactions
+bool LogDbTable::load(string* name)
+{
+    string path;
+
+    path = *name + ".snapshot";
+    fsaccess->path2local(&path, &snapshotname);
+    path = *name + ".snapshot.tmp";
+    fsaccess->path2local(&path, &tmpsnapshotname);
+    path = *name + ".log";
+    fsaccess->path2local(&path, &logname);
+
+    if (mapsnapshot() && !readsnapshot())
+    {
+        // unusable snapshot: start over (the log is incomplete without it)
+        unmapsnapshot();
+        fsaccess->unlinklocal(&snapshotname);
+
+        return resetlog();
+    }
+
+    logfa = fsaccess->newfileaccess();
+
+    if (!logfa->fopen(&logname, true, true))
+    {
+        return false;
+    }
+
+    if (logfa->size)
+    {
+        if (logfa->size != (unsigned)logfa->size)
+        {
+            return false;
+        }
+
+        logdata.resize(logfa->size);
+
+        if (!logfa->frawread((byte*)logdata.data(), logdata.size(), 0))
+        {
+            return false;
+        }
+
+        // (an incomplete trailing transaction is overwritten by the next
+        // commit)
+        replay();
+        logsize = logdata.size();
+    }
+
+    compactlogsize = (snapshotsize / 2 > MINCOMPACTSIZE) ? snapshotsize / 2 : MINCOMPACTSIZE;
+
+    if (logsize > compactlogsize)
+    {
+        compact();
+    }
+
+    rewind();
+
+    return true;
+}
+
+void LogDbTable::unmapsnapshot()
+{
+    delete snapshotfa;
+    snapshotfa = NULL;
+    snapshot = NULL;
+    snapshotsize = 0;
+    snapshotbuf.clear();
+    snapshotrecords.clear();
+}
+
+// map snapshot file - returns false if there is none
+bool LogDbTable::mapsnapshot()
+{
+    unmapsnapshot();
+
+    snapshotfa = fsaccess->newfileaccess();
+
+    if (!snapshotfa->fopen(&snapshotname, true, false))
+    {
+        delete snapshotfa;
+        snapshotfa = NULL;
+        return false;
+    }
+
+    snapshotsize = snapshotfa->size;
+
+    if (!(snapshot = (const char*)snapshotfa->fmap()))
+    {
+        // no mapping available: read the file
+        if (snapshotsize && snapshotsize == (unsigned)snapshotsize)
+        {
+            snapshotbuf.resize(snapshotsize);
+
+            if (snapshotfa->frawread((byte*)snapshotbuf.data(), snapshotbuf.size(), 0))
+            {
+                snapshot = snapshotbuf.data();
+            }
+        }
+
+        if (!snapshot)
+        {
+            snapshotbuf.clear();
+            snapshotsize = 0;
+        }
+    }
+
+    return true;
+}
+
+// index snapshot records
+bool LogDbTable::readsnapshot()
+{
+    uint32_t count, id, len;
+    m_off_t pos = SNAPSHOTHEADER;
+
+    snapshotrecords.clear();
+
+    if (snapshotsize < SNAPSHOTHEADER || memcmp(snapshot, SNAPSHOTMAGIC, 8))
+    {
+        return false;
+    }
+
+    memcpy(&count, snapshot + 8, sizeof count);
+
+    if (count > (snapshotsize - SNAPSHOTHEADER) / RECORDHEADER)
+    {
+        return false;
+    }
+
+    snapshotrecords.resize(count);
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        if (snapshotsize - pos < RECORDHEADER)
+        {
+            return false;
+        }
+
+        memcpy(&id, snapshot + pos, sizeof id);
+        memcpy(&len, snapshot + pos + sizeof id, sizeof len);
+        pos += RECORDHEADER;
+
+        if (snapshotsize - pos < len || (i && id <= snapshotrecords[i - 1].id))
+        {
+            return false;
+        }
+
+        snapshotrecords[i].id = id;
+        snapshotrecords[i].len = len;
+        snapshotrecords[i].offset = pos;
+
+        pos += len;
+    }
+
+    return pos == snapshotsize;
+}
+
+LogDbTable::SnapshotRecord* LogDbTable::findsnapshotrecord(uint32_t id)
+{
+    size_t lo = 0, hi = snapshotrecords.size();
+
+    while (lo < hi)
+    {
+        size_t mid = (lo + hi) / 2;
+
+        if (snapshotrecords[mid].id < id)
+        {
+            lo = mid + 1;
+        }
+        else
+        {
+            hi = mid;
+        }
+    }
+
+    if (lo < snapshotrecords.size() && snapshotrecords[lo].id == id && snapshotrecords[lo].len != DELETED)
+    {
+        return &snapshotrecords[lo];
+    }
+
+    return NULL;
+}
+
+void LogDbTable::addrecord(string* buf, uint32_t id, uint32_t len, const char* data)
+{
+    char header[RECORDHEADER];
+
+    memcpy(header, &id, sizeof id);
+    memcpy(header + sizeof id, &len, sizeof len);
+
+    buf->append(header, sizeof header);
+
+    if (data)
+    {
+        buf->append(data, len);
+    }
+}
+
+// FNV-1a variant operating on 64-bit words
+uint32_t LogDbTable::checksum(const char* data, size_t len)
+{
+    uint64_t h = 14695981039346656037ULL;
+    uint64_t w;
+
+    for (; len >= sizeof w; len -= sizeof w, data += sizeof w)
+    {
+        memcpy(&w, data, sizeof w);
+        h = (h ^ w) * 1099511628211ULL;
+    }
+
+    while (len--)
+    {
+        h = (h ^ (byte)*data++) * 1099511628211ULL;
+    }
+
+    return (uint32_t)(h ^ (h >> 32));
+}
+
+// apply the complete, uncorrupted transactions in logdata and discard the rest
+void LogDbTable::replay()
+{
+    const char* log = logdata.data();
+    size_t size = logdata.size();
+    size_t start = 0, pos = 0;
+    uint32_t id, len;
+
+    while (size - pos >= RECORDHEADER)
+    {
+        memcpy(&id, log + pos, sizeof id);
+        memcpy(&len, log + pos + sizeof id, sizeof len);
+
+        if (len == COMMITTED)
+        {
+            if (id != checksum(log + start, pos - start))
+            {
+                break;
+            }
+
+            apply(start, pos);
+
+            pos += RECORDHEADER;
+            start = pos;
+        }
+        else if (len == DELETED || len == TRUNCATED)
+        {
+            pos += RECORDHEADER;
+        }
+        else
+        {
+            if (size - pos - RECORDHEADER < len)
+            {
+                break;
+            }
+
+            pos += RECORDHEADER + len;
+        }
+    }
+
+    logdata.resize(start);
+}
+
+// apply the records of a committed transaction in logdata
+void LogDbTable::apply(size_t pos, size_t end)
+{
+    const char* data = logdata.data();
+    uint32_t id, len;
+    SnapshotRecord* r;
+
+    while (pos < end)
+    {
+        memcpy(&id, data + pos, sizeof id);
+        memcpy(&len, data + pos + sizeof id, sizeof len);
+        pos += RECORDHEADER;
+
+        if (len == TRUNCATED)
+        {
+            snapshotrecords.clear();
+            logrecords.clear();
+            continue;
+        }
+
+        if ((r = findsnapshotrecord(id)))
+        {
+            r->len = DELETED;
+        }
+
+        if (len == DELETED)
+        {
+            logrecords.erase(id);
+        }
+        else
+        {
+            LogRecord* lr = &logrecords[id];
+
+            lr->offset = pos;
+            lr->len = len;
+            pos += len;
+        }
+    }
+
+    // (modifications end a sequential read)
+    snapshotcursor = snapshotrecords.size();
+    logcursor = logrecords.end();
+}
+
+// replace the log with an empty one
+bool LogDbTable::resetlog()
+{
+    logrecords.clear();
+    logdata.clear();
+
+    delete logfa;
+
+    fsaccess->unlinklocal(&logname);
+
+    logfa = fsaccess->newfileaccess();
+    logsize = 0;
+
+    return logfa->fopen(&logname, true, true) && !logfa->size;
+}
+
+// discard snapshot and log after a failed write
+void LogDbTable::fail()
+{
+    failed = true;
+
+    unmapsnapshot();
+    fsaccess->unlinklocal(&snapshotname);
+    resetlog();
+
+    rewind();
+}
+
+// write all records to a new snapshot, ordered by id
+bool LogDbTable::compact()
+{
+    FileAccess* fa = fsaccess->newfileaccess();
+    string buf;
+    uint32_t count = 0;
+    m_off_t pos = SNAPSHOTHEADER;
+    size_t i = 0;
+    logrecord_map::iterator it = logrecords.begin();
+    bool success;
+
+    fsaccess->unlinklocal(&tmpsnapshotname);
+
+    success = fa->fopen(&tmpsnapshotname, false, true);
+
+    while (success && (i < snapshotrecords.size() || it != logrecords.end()))
+    {
+        if (it == logrecords.end() || (i < snapshotrecords.size() && snapshotrecords[i].id < it->first))
+        {
+            if (snapshotrecords[i].len != DELETED)
+            {
+                addrecord(&buf, snapshotrecords[i].id, snapshotrecords[i].len, snapshot + snapshotrecords[i].offset);
+                count++;
+            }
+
+            i++;
+        }
+        else
+        {
+            addrecord(&buf, it->first, it->second.len, logdata.data() + it->second.offset);
+            count++;
+            it++;
+        }
+
+        if (buf.size() >= 1048576 || (i == snapshotrecords.size() && it == logrecords.end()))
+        {
+            success = fa->fwrite((const byte*)buf.data(), buf.size(), pos);
+            pos += buf.size();
+            buf.clear();
+        }
+    }
+
+    if (success)
+    {
+        char header[SNAPSHOTHEADER];
+
+        memset(header, 0, sizeof header);
+        memcpy(header, SNAPSHOTMAGIC, 8);
+        memcpy(header + 8, &count, sizeof count);
+
+        success = fa->fwrite((const byte*)header, sizeof header, 0);
+    }
+
+    delete fa;
+
+    if (!success)
+    {
+        fsaccess->unlinklocal(&tmpsnapshotname);
+        return false;
+    }
+
+    // the mapping has to be released before the snapshot can be replaced
+    // (keeping the record index)
+    vector<SnapshotRecord> records;
+
+    records.swap(snapshotrecords);
+    unmapsnapshot();
+
+    if (!fsaccess->renamelocal(&tmpsnapshotname, &snapshotname, true))
+    {
+        fsaccess->unlinklocal(&tmpsnapshotname);
+
+        // continue with the old snapshot (record offsets are unchanged) and
+        // retry once the log has doubled in size
+        if (mapsnapshot())
+        {
+            records.swap(snapshotrecords);
+            compactlogsize = logsize * 2;
+            return false;
+        }
+    }
+    else if (mapsnapshot() && readsnapshot())
+    {
+        // (if we crash before the log is reset, replaying it again on top of
+        // the new snapshot is harmless)
+        resetlog();
+
+        compactlogsize = (snapshotsize / 2 > MINCOMPACTSIZE) ? snapshotsize / 2 : MINCOMPACTSIZE;
+
+        rewind();
+
+        return true;
+    }
+
+    // the cache is lost - make sure it is not used again
+    unmapsnapshot();
+    fsaccess->unlinklocal(&snapshotname);
+    resetlog();
+
+    compactlogsize = MINCOMPACTSIZE;
+
+    return false;
+}
+
+// set cursor to first record
+void LogDbTable::rewind()
+{
+    snapshotcursor = 0;
+    logcursor = logrecords.begin();
+}
+
+// retrieve next record through cursor
+bool LogDbTable::next(uint32_t* index, string* data)
+{
+    while (snapshotcursor < snapshotrecords.size())
+    {
+        SnapshotRecord* r = &snapshotrecords[snapshotcursor++];
+
+        if (r->len != DELETED)
+        {
+            *index = r->id;
+            data->assign(snapshot + r->offset, r->len);
+            return true;
+        }
+    }
+
+    if (logcursor != logrecords.end())
+    {
+        *index = logcursor->first;
+        data->assign(logdata.data() + logcursor->second.offset, logcursor->second.len);
+        logcursor++;
+        return true;
+    }
+
+    return false;
+}
+
+// retrieve record by index (uncommitted changes are not visible)
+bool LogDbTable::get(uint32_t index, string* data)
+{
+    logrecord_map::iterator it = logrecords.find(index);
+
+    if (it != logrecords.end())
+    {
+        data->assign(logdata.data() + it->second.offset, it->second.len);
+        return true;
+    }
+
+    SnapshotRecord* r = findsnapshotrecord(index);
+
+    if (r)
+    {
+        data->assign(snapshot + r->offset, r->len);
+        return true;
+    }
+
+    return false;
+}
+
+// add/update record by index
+bool LogDbTable::put(uint32_t index, char* data, unsigned len)
+{
+    if (len >= COMMITTED)
+    {
+        return false;
+    }
+
+    addrecord(&txn, index, len, data);
+
+    if (!intxn)
+    {
+        commit();
+    }
+
+    return true;
+}
+
+// delete record by index
+bool LogDbTable::del(uint32_t index)
+{
+    addrecord(&txn, index, DELETED);
+
+    if (!intxn)
+    {
+        commit();
+    }
+
+    return true;
+}
+
+// truncate table
+void LogDbTable::truncate()
+{
+    addrecord(&txn, 0, TRUNCATED);
+
+    if (!intxn)
+    {
+        commit();
+    }
+}
+
+// begin transaction
+void LogDbTable::begin()
+{
+    intxn = true;
+}
+
+// commit transaction: append to log, then apply
+void LogDbTable::commit()
+{
+    intxn = false;
+
+    if (!txn.size())
+    {
+        return;
+    }
+
+    if (failed)
+    {
+        txn.clear();
+        return;
+    }
+
+    size_t start = logdata.size();
+    size_t end = start + txn.size();
+
+    addrecord(&txn, checksum(txn.data(), txn.size()), COMMITTED);
+
+    if (!logfa->fwrite((const byte*)txn.data(), txn.size(), logsize))
+    {
+        // the persisted state would miss this transaction - discard the
+        // cache and ignore further writes rather than leave it inconsistent
+        txn.clear();
+        fail();
+        return;
+    }
+
+    logsize += txn.size();
+    logdata.append(txn);
+    txn.clear();
+
+    apply(start, end);
+
+    if (logsize > compactlogsize)
+    {
+        compact();
+    }
+}
+
+// abort transaction
+void LogDbTable::abort()
+{
+    intxn = false;
+    txn.clear();
+}
+} // namespace
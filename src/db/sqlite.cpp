@@ -23,12 +23,14 @@
 
 #ifdef USE_SQLITE
 namespace mega {
-SqliteDbAccess::SqliteDbAccess(string* path)
+SqliteDbAccess::SqliteDbAccess(string* path, int sync)
 {
     if (path)
     {
         dbpath = *path;
     }
+
+    synchronous = sync;
 }
 
 SqliteDbAccess::~SqliteDbAccess()
@@ -49,15 +51,25 @@ DbTable* SqliteDbAccess::open(FileSystemAccess* fsaccess, string* name)
 
     if (rc)
     {
+        sqlite3_close(db);
         return NULL;
     }
 
-    const char *sql = "CREATE TABLE IF NOT EXISTS statecache (id INTEGER PRIMARY KEY ASC NOT NULL, content BLOB NOT NULL)";
+    // write-ahead logging: a commit appends to the log instead of journaling
+    // and rewriting the touched pages (falls back to the rollback journal if
+    // WAL is unavailable)
+    char sql[64];
+
+    sqlite3_exec(db, "PRAGMA journal_mode=WAL", NULL, NULL, NULL);
+
+    sprintf(sql, "PRAGMA synchronous=%d", synchronous);
+    sqlite3_exec(db, sql, NULL, NULL, NULL);
 
-    rc = sqlite3_exec(db, sql, NULL, NULL, NULL);
+    rc = sqlite3_exec(db, "CREATE TABLE IF NOT EXISTS statecache (id INTEGER PRIMARY KEY ASC NOT NULL, content BLOB NOT NULL)", NULL, NULL, NULL);
 
     if (rc)
     {
+        sqlite3_close(db);
         return NULL;
     }
 
@@ -68,18 +80,38 @@ SqliteDbTable::SqliteDbTable(sqlite3* cdb)
 {
     db = cdb;
     pStmt = NULL;
+    pGetStmt = NULL;
+    pPutStmt = NULL;
+    pDelStmt = NULL;
 }
 
 SqliteDbTable::~SqliteDbTable()
 {
-    if (pStmt)
-    {
-        sqlite3_finalize(pStmt);
-    }
+    // (sqlite3_finalize() ignores NULL)
+    sqlite3_finalize(pStmt);
+    sqlite3_finalize(pGetStmt);
+    sqlite3_finalize(pPutStmt);
+    sqlite3_finalize(pDelStmt);
     abort();
     sqlite3_close(db);
 }
 
+// return cached prepared statement (reset and unbound) - NULL on failure
+sqlite3_stmt* SqliteDbTable::prepare(sqlite3_stmt** stmt, const char* sql)
+{
+    if (*stmt)
+    {
+        sqlite3_reset(*stmt);
+        sqlite3_clear_bindings(*stmt);
+    }
+    else if (sqlite3_prepare_v2(db, sql, -1, stmt, NULL))
+    {
+        *stmt = NULL;
+    }
+
+    return *stmt;
+}
+
 // set cursor to first record
 void SqliteDbTable::rewind()
 {
@@ -120,16 +152,14 @@ bool SqliteDbTable::next(uint32_t* index, string* data)
 // retrieve record by index
 bool SqliteDbTable::get(uint32_t index, string* data)
 {
-    sqlite3_stmt *stmt;
-
-    int rc = sqlite3_prepare(db, "SELECT content FROM statecache WHERE id = ?", -1, &stmt, NULL);
+    sqlite3_stmt* stmt = prepare(&pGetStmt, "SELECT content FROM statecache WHERE id = ?");
 
-    if (rc)
+    if (!stmt)
     {
         return false;
     }
 
-    rc = sqlite3_bind_int(stmt, 1, index);
+    int rc = sqlite3_bind_int(stmt, 1, index);
 
     if (rc)
     {
@@ -138,31 +168,28 @@ bool SqliteDbTable::get(uint32_t index, string* data)
 
     rc = sqlite3_step(stmt);
 
-    if (rc != SQLITE_ROW)
+    if (rc == SQLITE_ROW)
     {
-        return false;
+        data->assign((char*)sqlite3_column_blob(stmt, 0), sqlite3_column_bytes(stmt, 0));
     }
 
-    data->assign((char*)sqlite3_column_blob(stmt, 0), sqlite3_column_bytes(stmt, 0));
-
-    sqlite3_finalize(stmt);
+    // (release the read lock right away)
+    sqlite3_reset(stmt);
 
-    return true;
+    return rc == SQLITE_ROW;
 }
 
 // add/update record by index
 bool SqliteDbTable::put(uint32_t index, char* data, unsigned len)
 {
-    sqlite3_stmt *stmt;
+    sqlite3_stmt* stmt = prepare(&pPutStmt, "INSERT OR REPLACE INTO statecache (id, content) VALUES (?, ?)");
 
-    int rc = sqlite3_prepare(db, "INSERT OR REPLACE INTO statecache (id, content) VALUES (?, ?)", -1, &stmt, NULL);
-
-    if (rc)
+    if (!stmt)
     {
         return false;
     }
 
-    rc = sqlite3_bind_int(stmt, 1, index);
+    int rc = sqlite3_bind_int(stmt, 1, index);
 
     if (rc)
     {
@@ -178,23 +205,33 @@ bool SqliteDbTable::put(uint32_t index, char* data, unsigned len)
 
     rc = sqlite3_step(stmt);
 
-    if (rc != SQLITE_DONE)
-    {
-        return false;
-    }
+    // (data is bound statically and must not be referenced after return)
+    sqlite3_reset(stmt);
+    sqlite3_clear_bindings(stmt);
 
-    sqlite3_finalize(stmt);
-    return true;
+    return rc == SQLITE_DONE;
 }
 
 // delete record by index
 bool SqliteDbTable::del(uint32_t index)
 {
-    char buf[64];
+    sqlite3_stmt* stmt = prepare(&pDelStmt, "DELETE FROM statecache WHERE id = ?");
+
+    if (!stmt)
+    {
+        return false;
+    }
+
+    if (sqlite3_bind_int(stmt, 1, index))
+    {
+        return false;
+    }
+
+    int rc = sqlite3_step(stmt);
 
-    sprintf(buf, "DELETE FROM statecache WHERE id = %" PRIu32, index);
+    sqlite3_reset(stmt);
 
-    return !sqlite3_exec(db, buf, 0, 0, NULL);
+    return rc == SQLITE_DONE;
 }
 
 // truncate table
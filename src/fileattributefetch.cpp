@@ -22,11 +22,16 @@
 #include "mega/fileattributefetch.h"
 #include "mega/megaclient.h"
 #include "mega/megaapp.h"
+#include "mega/utils.h"
 
 namespace mega {
 FileAttributeFetchChannel::FileAttributeFetchChannel()
 {
     req.binary = true;
+
+    completed = 0;
+    inbase = 0;
+    parsed = 0;
 }
 
 FileAttributeFetch::FileAttributeFetch(handle h, fatype t, int c, int ctag)
@@ -58,7 +63,14 @@ void FileAttributeFetchChannel::dispatch(MegaClient* client, int fac, const char
     }
 
     completed = 0;
-    
+    inbase = 0;
+    parsed = 0;
+    index.clear();
+
+    // attributes are delivered (and freed) while the response is still
+    // being received, if the HttpIO layer permits
+    req.incremental = client->httpio->syncput;
+
     req.posturl = targeturl;
     req.post(client);
 }
@@ -78,32 +90,74 @@ void FileAttributeFetchChannel::parse(MegaClient* client, int fac, bool final)
     // data is structured as (handle.8.le / position.4.le)* attribute data
     // attributes are CBC-encrypted with the file's key
 
-    // we must have received at least one full header to continue
-    if (req.in.size() < sizeof(FaPos))
+    parsed = req.bufpos;
+
+    if (!index.size())
     {
-        if (final) client->faf_failed(fac);
-        return;
-    }
+        // we must have received at least one full header to continue
+        if (req.in.size() < sizeof(FaPos))
+        {
+            if (final) client->faf_failed(fac);
+            return;
+        }
 
-    uint32_t bod = ((FaPos*)req.in.data())->pos;
+        uint32_t bod = ((FaPos*)req.in.data())->pos;
 
-    if (req.in.size() < bod)
-    {
-        if (final) client->faf_failed(fac);
-        return;
+        if (req.in.size() < bod || bod < sizeof(FaPos) || bod % sizeof(FaPos))
+        {
+            if (final) client->faf_failed(fac);
+            return;
+        }
+
+        // move the record index out of the response buffer
+        index.assign(req.in.data(), bod);
+
+        if (req.incremental)
+        {
+            req.in.erase(0, bod);
+            inbase = bod;
+        }
     }
 
-    const char* fadata;
-    uint32_t falen, fapos;
+    const FaPos* fapos = (const FaPos*)index.data();
+    size_t numpos = index.size() / sizeof(FaPos);
+    size_t received = inbase + req.in.size();
+    size_t delivered = inbase;
+    size_t start, end;
+    uint32_t falen;
     Node* n;
     faf_map::iterator it;
 
-    fadata = req.in.data();
-
-    while (completed < bod - (final ? 0 : sizeof(FaPos))
-        && req.in.size() >= (falen = (final ? req.in.size() : ((FaPos*)(req.in.data() + completed))[1].pos)))
+    while (completed < numpos)
     {
-        it = client->fafs.find(((FaPos*)(req.in.data() + completed))->h);
+        start = fapos[completed].pos;
+
+        // (the last attribute ends with the response)
+        if (completed + 1 < numpos)
+        {
+            end = fapos[completed + 1].pos;
+        }
+        else if (final)
+        {
+            end = received;
+        }
+        else
+        {
+            break;
+        }
+
+        if (received < end)
+        {
+            break;
+        }
+
+        // (corrupt positions)
+        if (start < delivered || end < start)
+        {
+            break;
+        }
+
+        it = client->fafs.find(fapos[completed].h);
 
         // locate fetch request (could have been deleted by the application in the meantime)
         if (it != client->fafs.end())
@@ -111,16 +165,24 @@ void FileAttributeFetchChannel::parse(MegaClient* client, int fac, bool final)
             // locate related node (could have been deleted)
             if ((n = client->nodebyhandle(it->second->nodehandle)))
             {
-                fapos = ((FaPos*)(req.in.data() + completed))->pos;
-                falen -= fapos;
+                char* fadata = (char*)req.in.data() + start - inbase;
 
-                if (!(falen & (SymmCipher::BLOCKSIZE - 1)))
+                falen = end - start;
+
+                SymmCipher* cipher = n->nodecipher();
+
+                if (cipher && !(falen & (SymmCipher::BLOCKSIZE - 1)))
                 {
-                    n->key.cbc_decrypt((byte*)fadata + fapos, falen);
+                    cipher->cbc_decrypt((byte*)fadata, falen);
+
+                    if (client->facache)
+                    {
+                        client->facache->put(n->nodehandle, it->second->type, it->first, fadata, falen);
+                    }
 
                     client->restag = it->second->tag;
 
-                    client->app->fa_complete(n, it->second->type, fadata + fapos, falen);
+                    client->app->fa_complete(n, it->second->type, fadata, falen);
 
                     delete it->second;
                     client->fafs.erase(it);
@@ -135,13 +197,366 @@ void FileAttributeFetchChannel::parse(MegaClient* client, int fac, bool final)
         {
             return client->faf_failed(fac);
         }
-        
-        completed += sizeof(FaPos);
+
+        delivered = end;
+        completed++;
+    }
+
+    if (req.incremental)
+    {
+        // free delivered attribute data
+        req.in.erase(0, delivered - inbase);
+        inbase = delivered;
+
+        // an attribute that does not fit into the buffer limit indicates a
+        // corrupt response
+        if (!final && req.in.size() > MAXBUFFERED)
+        {
+            req.disconnect();
+            req.status = REQ_READY;
+            bt.backoff();
+
+            return client->faf_failed(fac);
+        }
     }
-    
-    if (final && completed != bod)
+
+    if (final && completed != numpos)
     {
         client->faf_failed(fac);
     }
 }
+
+FileAttributeCache::FileAttributeCache(size_t cmaxmemory, m_off_t cmaxdisk)
+{
+    maxmemory = cmaxmemory;
+    maxdisk = cmaxdisk;
+
+    table = NULL;
+    key = NULL;
+
+    memsize = 0;
+    disksize = 0;
+
+    hits = 0;
+    misses = 0;
+}
+
+FileAttributeCache::~FileAttributeCache()
+{
+    reset();
+}
+
+// record header: nodehandle.8 type.2 fah.8 size.4
+bool FileAttributeCache::Entry::serialize(string* d)
+{
+    d->append((char*)&nodehandle, sizeof nodehandle);
+    d->append((char*)&type, sizeof type);
+    d->append((char*)&fah, sizeof fah);
+    d->append((char*)&size, sizeof size);
+
+    return true;
+}
+
+FileAttributeCache::Entry* FileAttributeCache::Entry::unserialize(string* d)
+{
+    const char* ptr = d->data();
+    Entry* e;
+
+    if (d->size() != sizeof(handle) + sizeof(fatype) + sizeof(handle) + sizeof(uint32_t))
+    {
+        return NULL;
+    }
+
+    e = new Entry;
+
+    e->nodehandle = MemAccess::get<handle>(ptr);
+    ptr += sizeof(handle);
+
+    e->type = MemAccess::get<fatype>(ptr);
+    ptr += sizeof(fatype);
+
+    e->fah = MemAccess::get<handle>(ptr);
+    ptr += sizeof(handle);
+
+    e->size = MemAccess::get<uint32_t>(ptr);
+
+    return e;
+}
+
+// write entry with its data to the table
+bool FileAttributeCache::store(Entry* e)
+{
+    string record, d(e->data);
+
+    e->serialize(&record);
+    PaddedCBC::encrypt(&record, key);
+
+    PaddedCBC::encrypt(&d, key);
+    record.append(d);
+
+    e->dbid = table->newid(0);
+
+    return table->put(e->dbid, &record);
+}
+
+// read entry data from the table
+bool FileAttributeCache::load(Entry* e)
+{
+    string d, header;
+    Entry* t;
+    bool valid;
+
+    if (!table->get(e->dbid, &d) || d.size() <= RECORDHEADER)
+    {
+        return false;
+    }
+
+    // (guard against a reused record id)
+    header.assign(d, 0, RECORDHEADER);
+
+    if (!PaddedCBC::decrypt(&header, key) || !(t = Entry::unserialize(&header)))
+    {
+        return false;
+    }
+
+    valid = t->nodehandle == e->nodehandle && t->type == e->type && t->fah == e->fah && t->size == e->size;
+
+    delete t;
+
+    d.erase(0, RECORDHEADER);
+
+    if (!valid || !PaddedCBC::decrypt(&d, key) || d.size() != e->size)
+    {
+        return false;
+    }
+
+    e->data.swap(d);
+    memsize += e->size;
+    memlru.push_front(e);
+    e->memlruit = memlru.begin();
+
+    return true;
+}
+
+// mark as most recently used
+void FileAttributeCache::touch(Entry* e)
+{
+    lru.splice(lru.begin(), lru, e->lruit);
+
+    if (e->data.size())
+    {
+        memlru.splice(memlru.begin(), memlru, e->memlruit);
+    }
+}
+
+// drop data from memory (must be held in the table)
+void FileAttributeCache::unload(Entry* e)
+{
+    memsize -= e->size;
+    memlru.erase(e->memlruit);
+    string().swap(e->data);
+}
+
+void FileAttributeCache::remove(Entry* e)
+{
+    if (e->data.size())
+    {
+        unload(e);
+    }
+
+    if (e->dbid)
+    {
+        table->del(e->dbid);
+        disksize -= e->size;
+    }
+
+    lru.erase(e->lruit);
+    entries.erase(pair<handle, fatype>(e->nodehandle, e->type));
+
+    delete e;
+}
+
+// evict least recently used entries beyond the size limits
+void FileAttributeCache::trim()
+{
+    while (memsize > maxmemory)
+    {
+        Entry* e = memlru.back();
+
+        if (e->dbid)
+        {
+            unload(e);
+        }
+        else
+        {
+            remove(e);
+        }
+    }
+
+    while (disksize > maxdisk)
+    {
+        remove(lru.back());
+    }
+}
+
+bool FileAttributeCache::get(handle nodehandle, fatype type, handle fah, string* data)
+{
+    entry_map::iterator it = entries.find(pair<handle, fatype>(nodehandle, type));
+
+    if (it != entries.end())
+    {
+        Entry* e = it->second;
+
+        if (e->fah == fah)
+        {
+            if (e->data.size() || load(e))
+            {
+                *data = e->data;
+
+                touch(e);
+                trim();
+
+                hits++;
+                return true;
+            }
+        }
+
+        // outdated or unreadable
+        remove(e);
+    }
+
+    misses++;
+    return false;
+}
+
+void FileAttributeCache::put(handle nodehandle, fatype type, handle fah, const char* data, uint32_t len)
+{
+    entry_map::iterator it = entries.find(pair<handle, fatype>(nodehandle, type));
+
+    if (it != entries.end())
+    {
+        remove(it->second);
+    }
+
+    if (!len)
+    {
+        return;
+    }
+
+    Entry* e = new Entry;
+
+    e->nodehandle = nodehandle;
+    e->type = type;
+    e->fah = fah;
+    e->data.assign(data, len);
+    e->size = len;
+
+    entries[pair<handle, fatype>(nodehandle, type)] = e;
+
+    lru.push_front(e);
+    e->lruit = lru.begin();
+
+    memlru.push_front(e);
+    e->memlruit = memlru.begin();
+    memsize += len;
+
+    if (table && len <= maxdisk && store(e))
+    {
+        disksize += len;
+    }
+    else
+    {
+        e->dbid = 0;
+    }
+
+    trim();
+}
+
+// load the index of a (previously populated) table - only the record headers
+// are decrypted, the data is loaded on demand
+void FileAttributeCache::attach(DbTable* t, SymmCipher* k)
+{
+    uint32_t id;
+    string d;
+    Entry* e;
+
+    reset();
+
+    if (!(table = t))
+    {
+        return;
+    }
+
+    key = k;
+
+    table->rewind();
+
+    // (records are read in insertion order, so the most recent ends up first)
+    while (table->next(&id, &d, NULL))
+    {
+        e = NULL;
+
+        if (d.size() > RECORDHEADER)
+        {
+            // (the data must be the padded length given in the header)
+            size_t datalen = d.size() - RECORDHEADER;
+
+            d.resize(RECORDHEADER);
+
+            if (PaddedCBC::decrypt(&d, key) && (e = Entry::unserialize(&d))
+             && datalen != ((e->size + SymmCipher::BLOCKSIZE) & - SymmCipher::BLOCKSIZE))
+            {
+                delete e;
+                e = NULL;
+            }
+        }
+
+        if (!e)
+        {
+            table->del(id);
+            continue;
+        }
+
+        e->dbid = id;
+
+        entry_map::iterator it = entries.find(pair<handle, fatype>(e->nodehandle, e->type));
+
+        if (it != entries.end())
+        {
+            remove(it->second);
+        }
+
+        entries[pair<handle, fatype>(e->nodehandle, e->type)] = e;
+
+        lru.push_front(e);
+        e->lruit = lru.begin();
+        disksize += e->size;
+    }
+
+    // (the table is not modified during the sequential read)
+    trim();
+}
+
+bool FileAttributeCache::attached() const
+{
+    return table != NULL;
+}
+
+void FileAttributeCache::reset()
+{
+    for (entry_map::iterator it = entries.begin(); it != entries.end(); it++)
+    {
+        delete it->second;
+    }
+
+    entries.clear();
+    lru.clear();
+    memlru.clear();
+
+    memsize = 0;
+    disksize = 0;
+
+    delete table;
+    table = NULL;
+}
 } // namespace
@@ -117,27 +117,29 @@ bool FileFingerprint::genfingerprint(FileAccess* fa, bool ignoremtime)
     }
     else
     {
-        // large file: sparse coverage, four sparse CRC32s
+        // large file: sparse coverage, four sparse CRC32s (blocks read in one
+        // batch)
         HashCRC32 crc32;
-        byte block[4 * sizeof crc];
-        const unsigned blocks = MAXFULL / (sizeof block * sizeof crc / sizeof *crc);
+        const unsigned blocksize = 4 * sizeof crc;
+        const unsigned blocks = MAXFULL / (blocksize * sizeof crc / sizeof *crc);
+        const unsigned total = sizeof crc / sizeof *crc * blocks;
+        byte buf[MAXFULL];
+        m_off_t pos[total];
 
-        for (unsigned i = 0; i < sizeof crc / sizeof *crc; i++)
+        for (unsigned i = 0; i < total; i++)
+        {
+            pos[i] = (size - blocksize) * i / (total - 1);
+        }
+
+        if (!fa->frawread(buf, blocksize, pos, total))
         {
-            for (unsigned j = 0; j < blocks; j++)
-            {
-                if (!fa->frawread(block, sizeof block,
-                                  (size - sizeof block)
-                                  * (i * blocks + j)
-                                  / (sizeof crc / sizeof *crc * blocks - 1)))
-                {
-                    size = -1;
-                    return true;
-                }
-
-                crc32.add(block, sizeof block);
-            }
+            size = -1;
+            return true;
+        }
 
+        for (unsigned i = 0; i < sizeof crc / sizeof *crc; i++)
+        {
+            crc32.add(buf + i * blocks * blocksize, blocks * blocksize);
             crc32.get((byte*)&crcval);
             newcrc[i] = htonl(crcval);
         }
@@ -206,4 +206,52 @@ bool FileAccess::frawread(byte* dst, unsigned len, m_off_t pos)
 
     return r;
 }
+
+bool FileAccess::frawread(byte* dst, unsigned len, const m_off_t* pos, unsigned count)
+{
+    if (!openf())
+    {
+        return false;
+    }
+
+    bool r = true;
+    string span;
+
+    for (unsigned i = 0; r && i < count; )
+    {
+        // extend the run while the gaps between blocks are small
+        unsigned n = 1;
+
+        while (i + n < count
+               && pos[i + n] - (pos[i + n - 1] + len) <= COALESCEGAP
+               && pos[i + n] + len - pos[i] <= COALESCESPAN)
+        {
+            n++;
+        }
+
+        if (n == 1)
+        {
+            r = sysread(dst, len, pos[i]);
+        }
+        else
+        {
+            span.resize((size_t)(pos[i + n - 1] + len - pos[i]));
+
+            if ((r = sysread((byte*)span.data(), span.size(), pos[i])))
+            {
+                for (unsigned j = 0; j < n; j++)
+                {
+                    memcpy(dst + j * len, span.data() + (pos[i + j] - pos[i]), len);
+                }
+            }
+        }
+
+        dst += n * len;
+        i += n;
+    }
+
+    closef();
+
+    return r;
+}
 } // namespace
@@ -28,6 +28,23 @@ const int GfxProc::dimensions[][2] = {
     { 1000, 1000 }  // PREVIEW1000x1000: scaled version inside 1000x1000 bounding square
 };
 
+GfxProc::GfxProc()
+{
+    client = NULL;
+    jobsdone = 0;
+    jobsds = 0;
+}
+
+GfxProc::~GfxProc()
+{
+    canceljobs();
+
+    for (unsigned i = processors.size(); i--; )
+    {
+        delete processors[i];
+    }
+}
+
 bool GfxProc::isgfx(string* localfilename)
 {
     char ext[8];
@@ -57,6 +74,11 @@ const char* GfxProc::supportedformats()
     return NULL;
 }
 
+GfxProc* GfxProc::newprocessor()
+{
+    return NULL;
+}
+
 void GfxProc::transform(int& w, int& h, int& rw, int& rh, int& px, int& py)
 {
     if (rh)
@@ -100,43 +122,197 @@ void GfxProc::transform(int& w, int& h, int& rw, int& rh, int& px, int& py)
     }
 }
 
+// decode bitmap image, generate all designated sizes that are missing
+void GfxProc::genimages(FileAccess* fa, string* localfilename, int missing, vector<string>* images)
+{
+    int n = sizeof dimensions/sizeof dimensions[0];
+    int size = 0;
+
+    images->clear();
+    images->resize(n);
+
+    // decode at the smallest scale that is sufficient for the missing
+    // dimensions (longest side - square crops need headroom for non-square
+    // aspect ratios)
+    for (int i = n; i--; )
+    {
+        if (missing & (1 << i))
+        {
+            int s = dimensions[i][1] ? max(dimensions[i][0], dimensions[i][1])
+                                     : dimensions[i][0] * CROPHEADROOM;
+
+            if (s > size)
+            {
+                size = s;
+            }
+        }
+    }
+
+    if (size && readbitmap(fa, localfilename, size))
+    {
+        // successively downscale the original image
+        for (int i = n; i--; )
+        {
+            if (missing & (1 << i) && !resizebitmap(dimensions[i][0], dimensions[i][1], &(*images)[i]))
+            {
+                (*images)[i].clear();
+            }
+        }
+
+        freebitmap();
+    }
+}
+
 // load bitmap image, generate all designated sizes, attach to specified upload/node handle
-// FIXME: move to a worker thread to keep the engine nonblocking
+// (queued for a worker thread if the implementation supports it)
 void GfxProc::gendimensionsputfa(FileAccess* fa, string* localfilename, handle th, SymmCipher* key, int missing)
 {
     if (isgfx(localfilename))
     {
-        // (this assumes that the width of the largest dimension is max)
-        if (readbitmap(fa, localfilename, dimensions[sizeof dimensions/sizeof dimensions[0]-1][0]))
+        if (client->workers->numthreads())
         {
-            string* jpeg = NULL;
+            GfxProc* processor;
 
-            // successively downscale the original image
-            for (int i = sizeof dimensions/sizeof dimensions[0]; i--; )
+            if (!processors.size() && (processor = newprocessor()))
             {
-                if (!jpeg)
-                {
-                    jpeg = new string;
-                }
-
-                if (missing & (1 << i) && resizebitmap(dimensions[i][0], dimensions[i][1], jpeg))
-                {
-                    // store the file attribute data - it will be attached to the file
-                    // immediately if the upload has already completed; otherwise, once
-                    // the upload completes
-                    client->putfa(th, (meta_t)i, key, jpeg);
-					
-                    jpeg = NULL;
-                }
+                processor->client = client;
+                processors.push_back(processor);
+                idleprocessors.push_back(processor);
             }
 
-            if (jpeg)
+            if (processors.size())
             {
-                delete jpeg;
+                GfxJob* job = new GfxJob;
+
+                job->gfx = this;
+                job->processor = NULL;
+                job->localfilename = *localfilename;
+                job->th = th;
+                job->missing = missing;
+                memcpy(job->key, key->key, sizeof job->key);
+                job->queuedds = Waiter::ds;
+
+                queuedjobs.push_back(job);
+                dispatch();
+
+                return;
             }
+        }
 
-            freebitmap();
+        vector<string> images;
+
+        genimages(fa, localfilename, missing, &images);
+
+        for (unsigned i = 0; i < images.size(); i++)
+        {
+            if (images[i].size())
+            {
+                // store the file attribute data - it will be attached to the file
+                // immediately if the upload has already completed; otherwise, once
+                // the upload completes
+                client->putfa(th, (meta_t)i, key, new string(images[i]));
+            }
         }
     }
 }
+
+// start queued jobs on idle processor instances (adding instances up to the
+// concurrency limit)
+void GfxProc::dispatch()
+{
+    while (queuedjobs.size())
+    {
+        if (!idleprocessors.size())
+        {
+            GfxProc* processor;
+
+            if (processors.size() >= MAXPROCESSORS
+             || processors.size() >= client->workers->numthreads()
+             || !(processor = newprocessor()))
+            {
+                break;
+            }
+
+            processor->client = client;
+            processors.push_back(processor);
+            idleprocessors.push_back(processor);
+        }
+
+        GfxJob* job = queuedjobs.front();
+
+        queuedjobs.pop_front();
+
+        job->processor = idleprocessors.back();
+        idleprocessors.pop_back();
+
+        runningjobs.insert(job);
+        client->workers->push(job);
+    }
+}
+
+void GfxProc::completejob(GfxJob* job)
+{
+    SymmCipher key;
+    char buf[128];
+    unsigned n = 0;
+
+    runningjobs.erase(job);
+    idleprocessors.push_back(job->processor);
+
+    key.setkey(job->key);
+
+    for (unsigned i = 0; i < job->images.size(); i++)
+    {
+        if (job->images[i].size())
+        {
+            client->putfa(job->th, (meta_t)i, &key, new string(job->images[i]));
+            n++;
+        }
+    }
+
+    jobsdone++;
+    jobsds += Waiter::ds - job->queuedds;
+
+    sprintf(buf, "Generated %u image(s) in %u ds (%u pending)",
+            n, (unsigned)(Waiter::ds - job->queuedds), pendingjobs());
+    client->app->debug_log(buf);
+
+    delete job;
+
+    dispatch();
+}
+
+void GfxProc::canceljobs()
+{
+    while (queuedjobs.size())
+    {
+        delete queuedjobs.front();
+        queuedjobs.pop_front();
+    }
+
+    while (runningjobs.size())
+    {
+        GfxJob* job = *runningjobs.begin();
+
+        runningjobs.erase(runningjobs.begin());
+        idleprocessors.push_back(job->processor);
+        client->workers->cancel(job);
+    }
+}
+
+unsigned GfxProc::pendingjobs() const
+{
+    return queuedjobs.size() + runningjobs.size();
+}
+
+// (worker thread)
+void GfxJob::run()
+{
+    processor->genimages(NULL, &localfilename, missing, &images);
+}
+
+void GfxJob::complete(MegaClient*)
+{
+    gfx->completejob(this);
+}
 } // namespace
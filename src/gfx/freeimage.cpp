@@ -42,6 +42,12 @@ const char* GfxProcFreeImage::supportedformats()
            ".xbm.xpm.jp2.j2k.jpf.jpx.";
 }
 
+// FreeImage bitmaps are independent - one instance per worker thread
+GfxProc* GfxProcFreeImage::newprocessor()
+{
+    return new GfxProcFreeImage;
+}
+
 bool GfxProcFreeImage::readbitmap(FileAccess* fa, string* localname, int size)
 {
 #ifdef _WIN32
@@ -93,9 +99,19 @@ bool GfxProcFreeImage::readbitmap(FileAccess* fa, string* localname, int size)
     }
     else
     {
-        // load all other image types - for RAW formats, rely on embedded preview
-        if (!(dib = FreeImage_LoadX(fif, (freeimage_filename_char_t*)localname->data(),
-                                    (fif == FIF_RAW) ? RAW_PREVIEW : 0)))
+        int flags = 0;
+
+        // load all other image types - for RAW formats, rely on embedded
+        // preview (if there is none, demosaic at half size)
+        if (fif == FIF_RAW)
+        {
+            flags = RAW_PREVIEW;
+#ifdef RAW_HALFSIZE
+            flags |= RAW_HALFSIZE;
+#endif
+        }
+
+        if (!(dib = FreeImage_LoadX(fif, (freeimage_filename_char_t*)localname->data(), flags)))
         {
 #ifdef _WIN32
             localname->resize(localname->size()-1);
@@ -106,39 +122,45 @@ bool GfxProcFreeImage::readbitmap(FileAccess* fa, string* localname, int size)
         w = FreeImage_GetWidth(dib);
         h = FreeImage_GetHeight(dib);
     }
-    
+
+    level = NULL;
+
     return true;
 }
 
 bool GfxProcFreeImage::resizebitmap(int rw, int rh, string* jpegout)
 {
+    FIBITMAP* sdib;
     FIBITMAP* tdib;
     FIMEMORY* hmem;
+    int sw = w, sh = h;
     int px, py;
 
     if (!w || !h) return false;
     
-    transform(w, h, rw, rh, px, py);
+    transform(sw, sh, rw, rh, px, py);
 
-    if (!w || !h) return false;
+    if (!sw || !sh) return false;
 
     jpegout->clear();
 
-    if ((tdib = FreeImage_Rescale(dib, w, h, FILTER_BILINEAR)))
+    // derive from the previous dimension unless it would have to be upscaled
+    if (level && (int)FreeImage_GetWidth(level) >= sw && (int)FreeImage_GetHeight(level) >= sh)
     {
-        FreeImage_Unload(dib);
-
-        dib = tdib;
+        sdib = FreeImage_Rescale(level, sw, sh, FILTER_BILINEAR);
+    }
+    else
+    {
+        sdib = FreeImage_Rescale(dib, sw, sh, FILTER_BILINEAR);
+    }
 
-        if ((tdib = FreeImage_Copy(dib, px, py, px + rw, py + rh)))
+    if (sdib)
+    {
+        if ((tdib = FreeImage_Copy(sdib, px, py, px + rw, py + rh)))
         {
-            FreeImage_Unload(dib);
-
-            dib = tdib;
-
             if ((hmem = FreeImage_OpenMemory()))
             {
-                if (FreeImage_SaveToMemory(FIF_JPEG, dib, hmem, JPEG_BASELINE | JPEG_OPTIMIZE | 85))
+                if (FreeImage_SaveToMemory(FIF_JPEG, tdib, hmem, JPEG_BASELINE | JPEG_OPTIMIZE | 85))
                 {
                     BYTE* tdata;
                     DWORD tlen;
@@ -149,7 +171,17 @@ bool GfxProcFreeImage::resizebitmap(int rw, int rh, string* jpegout)
 
                 FreeImage_CloseMemory(hmem);
             }
+
+            FreeImage_Unload(tdib);
         }
+
+        // (uncropped)
+        if (level)
+        {
+            FreeImage_Unload(level);
+        }
+
+        level = sdib;
     }
 
     return !!jpegout->size();
@@ -157,6 +189,11 @@ bool GfxProcFreeImage::resizebitmap(int rw, int rh, string* jpegout)
 
 void GfxProcFreeImage::freebitmap()
 {
+    if (level)
+    {
+        FreeImage_Unload(level);
+    }
+
     FreeImage_Unload(dib);
 }
 } // namespace
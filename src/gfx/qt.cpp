@@ -335,6 +335,12 @@ void GfxProcQT::freebitmap()
     delete image;
 }
 
+// QImageReader/QImage are reentrant - one instance per worker thread
+GfxProc* GfxProcQT::newprocessor()
+{
+    return new GfxProcQT;
+}
+
 QImage GfxProcQT::createThumbnail(QString imagePath)
 {
     int w, h, orientation;
@@ -26,6 +26,7 @@ namespace mega {
 HttpIO::HttpIO()
 {
     success = false;
+    syncput = false;
     noinetds = 0;
     inetback = false;
 }
@@ -78,6 +79,8 @@ HttpReq::HttpReq(int b)
 
     status = REQ_READY;
     buf = NULL;
+    bufpos = 0;
+    incremental = false;
 
     httpio = NULL;
     httpiohandle = NULL;
@@ -123,7 +126,7 @@ void HttpReq::put(void* data, unsigned len)
 // set total response size
 void HttpReq::setcontentlength(m_off_t len)
 {
-    if (!buf) in.reserve(len);
+    if (!buf && !incremental) in.reserve(len);
     contentlength = len;
 }
 
@@ -164,6 +167,31 @@ m_off_t HttpReq::transferred(MegaClient*)
     }
 }
 
+// a request may span several chunks - the chunk MACs are computed
+// individually, so that the meta MAC is independent of the request size
+void HttpReqXfer::chunkcrypt(SymmCipher* key, byte* data, unsigned len, m_off_t pos,
+                             uint64_t ctriv, chunkmac_map* macs, int encrypt)
+{
+    // (an empty request still yields its MAC)
+    if (!len)
+    {
+        key->ctr_crypt(data, 0, pos, ctriv, (*macs)[pos].mac, encrypt);
+        return;
+    }
+
+    while (len)
+    {
+        m_off_t npos = ChunkedHash::chunkceil(pos);
+        unsigned n = (npos - pos < len) ? (unsigned)(npos - pos) : len;
+
+        key->ctr_crypt(data, n, pos, ctriv, (*macs)[pos].mac, encrypt);
+
+        data += n;
+        pos += n;
+        len -= n;
+    }
+}
+
 // prepare file chunk download
 bool HttpReqDL::prepare(FileAccess* fa, const char* tempurl, SymmCipher* key,
                         chunkmac_map* macs, uint64_t ctriv, m_off_t pos,
@@ -196,9 +224,7 @@ bool HttpReqDL::prepare(FileAccess* fa, const char* tempurl, SymmCipher* key,
 void HttpReqDL::finalize(FileAccess* fa, SymmCipher* key, chunkmac_map* macs,
                          uint64_t ctriv, m_off_t startpos, m_off_t endpos)
 {
-    byte mac[SymmCipher::BLOCKSIZE] = { 0 };
-
-    key->ctr_crypt(buf, bufpos, dlpos, ctriv, mac, 0);
+    chunkcrypt(key, buf, bufpos, dlpos, ctriv, macs, 0);
 
     unsigned skip;
     unsigned prune;
@@ -230,8 +256,6 @@ void HttpReqDL::finalize(FileAccess* fa, SymmCipher* key, chunkmac_map* macs,
     }
 
     fa->fwrite(buf + skip, bufpos - skip - prune, dlpos + skip);
-
-    memcpy((*macs)[dlpos].mac, mac, sizeof mac);
 }
 
 // prepare chunk for uploading: mac and encrypt
@@ -246,15 +270,12 @@ bool HttpReqUL::prepare(FileAccess* fa, const char* tempurl, SymmCipher* key,
         return false;
     }
 
-    byte mac[SymmCipher::BLOCKSIZE] = { 0 };
     char buf[256];
 
     snprintf(buf, sizeof buf, "%s/%" PRIu64, tempurl, pos);
     setreq(buf, REQ_BINARY);
 
-    key->ctr_crypt((byte*)out->data(), size, pos, ctriv, mac, 1);
-
-    memcpy((*macs)[pos].mac, mac, sizeof mac);
+    chunkcrypt(key, (byte*)out->data(), size, pos, ctriv, macs, 1);
 
     // unpad for POSTing
     out->resize(size);
@@ -23,14 +23,200 @@
 #include "mega/base64.h"
 #include "mega/megaclient.h"
 
+// vectorized string scanning (x86/x64 only, selected at runtime)
+#if (defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)) \
+    && (defined(_MSC_VER) || defined(__clang__) || (defined(__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))))
+#define MEGA_JSONSIMD 1
+#include <emmintrin.h>
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define SSE2_TARGET
+#define AVX2_TARGET
+#else
+#define SSE2_TARGET __attribute__((target("sse2")))
+#define AVX2_TARGET __attribute__((target("avx2")))
+#endif
+#endif
+
 namespace mega {
+// portable string scanner
+static const char* stringend_portable(const char* ptr)
+{
+    bool escaped = false;
+
+    while (*ptr && (escaped || *ptr != '"'))
+    {
+        escaped = *ptr == '\\' && !escaped;
+        ptr++;
+    }
+
+    return *ptr ? ptr : NULL;
+}
+
+#ifdef MEGA_JSONSIMD
+static inline unsigned lowestbit(unsigned mask)
+{
+#ifdef _MSC_VER
+    unsigned long i;
+
+    _BitScanForward(&i, mask);
+
+    return i;
+#else
+    return __builtin_ctz(mask);
+#endif
+}
+
+// the SIMD scanners locate the next quote, backslash or NUL a block at a time
+// - the loads are aligned and thus never cross a page boundary, so reading
+// past the terminating NUL is safe
+SSE2_TARGET static const char* stringend_sse2(const char* ptr)
+{
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    const __m128i zero = _mm_setzero_si128();
+
+    for (;;)
+    {
+        const char* block = (const char*)((uintptr_t)ptr & ~(uintptr_t)15);
+        __m128i v = _mm_load_si128((const __m128i*)block);
+
+        unsigned mask = _mm_movemask_epi8(_mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, quote),
+                                                                    _mm_cmpeq_epi8(v, backslash)),
+                                                       _mm_cmpeq_epi8(v, zero)));
+
+        mask &= ~0U << (ptr - block);
+
+        if (!mask)
+        {
+            ptr = block + 16;
+            continue;
+        }
+
+        const char* hit = block + lowestbit(mask);
+
+        if (*hit != '\\')
+        {
+            return *hit ? hit : NULL;
+        }
+
+        // skip escaped character
+        if (!hit[1])
+        {
+            return NULL;
+        }
+
+        ptr = hit + 2;
+    }
+}
+
+AVX2_TARGET static const char* stringend_avx2(const char* ptr)
+{
+    const __m256i quote = _mm256_set1_epi8('"');
+    const __m256i backslash = _mm256_set1_epi8('\\');
+    const __m256i zero = _mm256_setzero_si256();
+
+    for (;;)
+    {
+        const char* block = (const char*)((uintptr_t)ptr & ~(uintptr_t)31);
+        __m256i v = _mm256_load_si256((const __m256i*)block);
+
+        unsigned mask = _mm256_movemask_epi8(_mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(v, quote),
+                                                                             _mm256_cmpeq_epi8(v, backslash)),
+                                                             _mm256_cmpeq_epi8(v, zero)));
+
+        mask &= ~0U << (ptr - block);
+
+        if (!mask)
+        {
+            ptr = block + 32;
+            continue;
+        }
+
+        const char* hit = block + lowestbit(mask);
+
+        if (*hit != '\\')
+        {
+            return *hit ? hit : NULL;
+        }
+
+        // skip escaped character
+        if (!hit[1])
+        {
+            return NULL;
+        }
+
+        ptr = hit + 2;
+    }
+}
+
+static int simdsupported()
+{
+#ifdef _MSC_VER
+    int info[4];
+
+    __cpuid(info, 0);
+
+    if (info[0] >= 7)
+    {
+        __cpuidex(info, 1, 0);
+
+        // AVX2 also requires OS support for the YMM state
+        if ((info[2] & (1 << 27)) && (info[2] & (1 << 28)) && (_xgetbv(0) & 6) == 6)
+        {
+            __cpuidex(info, 7, 0);
+
+            if (info[1] & (1 << 5))
+            {
+                return 2;
+            }
+        }
+    }
+
+    __cpuid(info, 1);
+
+    return (info[3] & (1 << 26)) ? 1 : 0;
+#else
+    __builtin_cpu_init();
+
+    if (__builtin_cpu_supports("avx2"))
+    {
+        return 2;
+    }
+
+    return __builtin_cpu_supports("sse2") ? 1 : 0;
+#endif
+}
+
+int JSON::simd = simdsupported();
+#else
+int JSON::simd = 0;
+#endif
+
+const char* JSON::stringend(const char* ptr)
+{
+#ifdef MEGA_JSONSIMD
+    if (simd > 1)
+    {
+        return stringend_avx2(ptr);
+    }
+
+    if (simd)
+    {
+        return stringend_sse2(ptr);
+    }
+#endif
+
+    return stringend_portable(ptr);
+}
+
 // store array or object in string s
 // reposition after object
 bool JSON::storeobject(string* s)
 {
     int openobject[2] = { 0 };
     const char* ptr;
-    bool escaped = false;
 
     while (*pos > 0 && *pos <= ' ')
     {
@@ -56,15 +242,7 @@ bool JSON::storeobject(string* s)
         }
         else if (*ptr == '"')
         {
-            ptr++;
-
-            while (*ptr && (escaped || *ptr != '"'))
-            {
-                escaped = *ptr == '\\' && !escaped;
-                ptr++;
-            }
-
-            if (!*ptr)
+            if (!(ptr = stringend(ptr + 1)))
             {
                 return false;
             }
@@ -154,15 +154,18 @@ void MegaClient::mergenewshares(bool notify)
                 if (s->outgoing)
                 {
                     // outgoing share to user u deleted
-                    if (n->outshares.erase(s->peer) && notify)
+                    if (n->outshares && n->outshares->erase(s->peer) && notify)
                     {
                         n->changed.outshares = true;
                         notifynode(n);
                     }
 
                     // if no other outgoing shares remain on this node, erase sharekey
-                    if (!n->outshares.size())
+                    if (!n->outshares || !n->outshares->size())
                     {
+                        delete n->outshares;
+                        n->outshares = NULL;
+
                         delete n->sharekey;
                         n->sharekey = NULL;
                     }
@@ -184,7 +187,12 @@ void MegaClient::mergenewshares(bool notify)
                         // only on own nodes and signed unless read from cache
                         if (checkaccess(n, OWNERPRELOGIN))
                         {
-                            Share** sharep = &n->outshares[s->peer];
+                            if (!n->outshares)
+                            {
+                                n->outshares = new share_map;
+                            }
+
+                            Share** sharep = &(*n->outshares)[s->peer];
 
                             // modification of existing share or new share
                             if (*sharep)
@@ -314,6 +322,15 @@ Node* MegaClient::childnodebyname(Node* p, const char* name)
 
     fsaccess->normalize(&nname);
 
+    namenode_map* childnames = p->namedchildren();
+
+    if (childnames)
+    {
+        namenode_map::iterator it = childnames->find(nname);
+
+        return it == childnames->end() ? NULL : it->second;
+    }
+
     for (node_list::iterator it = p->children.begin(); it != p->children.end(); it++)
     {
         if (!strcmp(nname.c_str(), (*it)->displayname()))
@@ -347,11 +364,8 @@ void MegaClient::init()
     pendingcs = NULL;
     pendingsc = NULL;
 
-    curfa = newfa.end();
-
     btcs.reset();
     btsc.reset();
-    btpfa.reset();
 
     syncadding = 0;
     syncactivity = false;
@@ -376,9 +390,15 @@ void MegaClient::init()
 MegaClient::MegaClient(MegaApp* a, Waiter* w, HttpIO* h, FileSystemAccess* f, DbAccess* d, GfxProc* g, const char* k, const char* u)
 {
     sctable = NULL;
+    facache = NULL;
     syncscanstate = false;
     me = UNDEF;
 
+    tmpnodecipherhandle = UNDEF;
+
+    nodeslab = new SlabAllocator(sizeof(Node));
+    localnodeslab = new SlabAllocator(sizeof(LocalNode));
+
     init();
 
     f->client = this;
@@ -398,9 +418,12 @@ MegaClient::MegaClient(MegaApp* a, Waiter* w, HttpIO* h, FileSystemAccess* f, Db
          g->client = this;
     }
 
+    workers = new WorkerPool(w);
+
     slotit = tslots.end();
 
     userid = 0;
+    uploadfacount = 0;
 
     connections[PUT] = 3;
     connections[GET] = 4;
@@ -453,7 +476,16 @@ MegaClient::~MegaClient()
     delete pendingcs;
     delete pendingsc;
     delete sctable;
+    delete facache;
     delete dbaccess;
+    delete workers;
+    delete localnodeslab;
+    delete nodeslab;
+}
+
+void MegaClient::setworkerthreads(unsigned n)
+{
+    workers->start(n);
 }
 
 // nonblocking state machine executing all operations currently in progress
@@ -484,10 +516,14 @@ void MegaClient::exec()
     }
 
     do {
-        // file attribute puts (handled sequentially, newest-to-oldest)
-        if (curfa != newfa.end())
+        // deliver results of finished worker jobs
+        workers->exec(this);
+
+        // file attribute puts (handled in parallel)
+        for (putfa_list::iterator it = activefa.begin(); it != activefa.end(); )
         {
-            HttpReqCommandPutFA* fa = *curfa;
+            HttpReqCommandPutFA* fa = *it;
+            putfa_list::iterator cur = it++;
 
             switch (fa->status)
             {
@@ -500,16 +536,16 @@ void MegaClient::exec()
 
                         Node* n;
                         handle h;
-                        handlepair_set::iterator it;
+                        handlepair_set::iterator uit;
 
                         // do we have a valid upload handle?
                         h = fa->th;
 
-                        it = uhnh.lower_bound(pair<handle, handle>(h, 0));
+                        uit = uhnh.lower_bound(pair<handle, handle>(h, 0));
 
-                        if ((it != uhnh.end()) && (it->first == h))
+                        if ((uit != uhnh.end()) && (uit->first == h))
                         {
-                            h = it->second;
+                            h = uit->second;
                         }
 
                         // are we updating a live node? issue command directly.
@@ -525,30 +561,40 @@ void MegaClient::exec()
                         }
 
                         delete fa;
-                        newfa.erase(curfa);
+                        activefa.erase(cur);
+                        break;
                     }
 
-                    btpfa.reset();
-                    curfa = newfa.end();
-                    break;
+                    // (invalid response - treated as failure)
 
                 case REQ_FAILURE:
                     // repeat request with exponential backoff
-                    curfa = newfa.end();
-                    btpfa.backoff();
+                    fa->status = REQ_READY;
+                    fa->bt.backoff();
+                    retryfa.splice(retryfa.end(), activefa, cur);
 
                 default:
                     ;
             }
         }
 
-        if (newfa.size() && (curfa == newfa.end()) && btpfa.armed())
+        dispatchputfa();
+
+        // deliver file attributes served from the cache
+        while (fafcached.size())
         {
-            // dispatch most recent file attribute put
-            curfa = newfa.begin();
+            FileAttributeFetch* f = fafcached.begin()->second;
+            Node* n;
+
+            fafcached.erase(fafcached.begin());
+
+            if ((n = nodebyhandle(f->nodehandle)))
+            {
+                restag = f->tag;
+                app->fa_complete(n, f->type, f->data.data(), f->data.size());
+            }
 
-            (*curfa)->status = REQ_INFLIGHT;
-            reqs[r].add(*curfa);
+            delete f;
         }
 
         if (fafcs.size())
@@ -632,6 +678,11 @@ void MegaClient::exec()
                         {
                             app->request_response_progress(pendingcs->bufpos, pendingcs->contentlength);
                         }
+
+                        if (pendingcs->incremental)
+                        {
+                            reqs[r ^ 1].procpartial(this, pendingcs);
+                        }
                         break;
 
                     case REQ_SUCCESS:
@@ -689,6 +740,11 @@ void MegaClient::exec()
                     case REQ_FAILURE:   // failure, repeat with capped exponential backoff
                         app->request_response_progress(pendingcs->bufpos, -1);
 
+                        if (pendingcs->incremental)
+                        {
+                            reqs[r ^ 1].cancelpartial(this);
+                        }
+
                         delete pendingcs;
                         pendingcs = NULL;
 
@@ -727,6 +783,7 @@ void MegaClient::exec()
                     pendingcs->posturl.append(appkey);
 
                     pendingcs->type = REQ_JSON;
+                    pendingcs->incremental = httpio->syncput && reqs[r].incremental();
 
                     pendingcs->post(this);
 
@@ -932,6 +989,16 @@ void MegaClient::exec()
 
         syncactivity = false;
 
+        // resume state cache flushes that exceeded their batch size or time
+        // budget
+        for (it = syncs.begin(); it != syncs.end(); it++)
+        {
+            if ((*it)->cacheflushpending)
+            {
+                (*it)->cachenodes();
+            }
+        }
+
         // halt all syncing while the local filesystem is pending a lock-blocked operation
         // FIXME: indicate by callback
         if (!syncdownretry && !syncadding)
@@ -1193,6 +1260,14 @@ void MegaClient::exec()
                                             // recursively delete all LocalNodes that were deleted (not moved or renamed!)
                                             sync->deletemissing(&sync->localroot);
                                             sync->cachenodes();
+
+                                            char buf[128];
+
+                                            sprintf(buf, "Sync scan complete: %u fingerprints reused, %u generated",
+                                                    sync->fingerprinthits, sync->fingerprintmisses);
+                                            app->debug_log(buf);
+
+                                            sync->stopprefetch();
                                         }
 
                                         // if the directory events notification subsystem is permanently unavailable or
@@ -1206,6 +1281,7 @@ void MegaClient::exec()
                                                 syncscanfailed = true;
 
                                                 sync->scan(&sync->localroot.localname, NULL);
+                                                sync->startprefetch();
                                                 sync->dirnotify->error = false;
                                                 fsaccess->notifyerr = false;
 
@@ -1255,7 +1331,7 @@ void MegaClient::exec()
         {
             notifypurge();
         }
-    } while (httpio->doio() || (!pendingcs && reqs[r].cmdspending() && btcs.armed()));
+    } while (httpio->doio() || (!pendingcs && reqs[r].cmdspending() && btcs.armed()) || fafcreceived());
 
     if (!badhostcs && badhosts.size())
     {
@@ -1279,8 +1355,9 @@ int MegaClient::wait()
     // get current dstime and clear wait events
     waiter->bumpds();
 
-    // sync directory scans in progress? don't wait.
-    if (syncactivity)
+    // sync directory scans in progress or cached file attributes to
+    // deliver? don't wait.
+    if (syncactivity || fafcached.size())
     {
         nds = Waiter::ds;
     }
@@ -1313,10 +1390,10 @@ int MegaClient::wait()
             btsc.update(&nds);
         }
 
-        // retry failed file attribute puts
-        if (curfa == newfa.end())
+        // retry failed file attribute puts (in order of failure)
+        if (activefa.size() < MAXPUTFA && retryfa.size())
         {
-            btpfa.update(&nds);
+            retryfa.front()->bt.update(&nds);
         }
 
         // retry failed file attribute gets
@@ -1413,7 +1490,7 @@ bool MegaClient::abortbackoff()
         r = true;
     }
 
-    if ((curfa == newfa.end()) && btpfa.arm())
+    if (retryfa.size() && retryfa.front()->bt.arm())
     {
         r = true;
     }
@@ -1670,7 +1747,7 @@ void MegaClient::disconnect()
         (*it)->disconnect();
     }
 
-    for (putfa_list::iterator it = newfa.begin(); it != newfa.end(); it++)
+    for (putfa_list::iterator it = activefa.begin(); it != activefa.end(); it++)
     {
         (*it)->disconnect();
     }
@@ -1705,12 +1782,42 @@ void MegaClient::logout()
         reqs[i].clear();
     }
 
-    for (putfa_list::iterator it = newfa.begin(); it != newfa.end(); it++)
+    if (gfx)
+    {
+        gfx->canceljobs();
+    }
+
+    for (putfa_list::iterator it = readyfa.begin(); it != readyfa.end(); it++)
     {
         delete *it;
     }
 
-    newfa.clear();
+    readyfa.clear();
+
+    for (handleputfa_map::iterator it = uploadfa.begin(); it != uploadfa.end(); it++)
+    {
+        for (putfa_list::iterator fit = it->second.begin(); fit != it->second.end(); fit++)
+        {
+            delete *fit;
+        }
+    }
+
+    uploadfa.clear();
+    uploadfacount = 0;
+
+    for (putfa_list::iterator it = retryfa.begin(); it != retryfa.end(); it++)
+    {
+        delete *it;
+    }
+
+    retryfa.clear();
+
+    for (putfa_list::iterator it = activefa.begin(); it != activefa.end(); it++)
+    {
+        delete *it;
+    }
+
+    activefa.clear();
 
     for (faf_map::iterator it = fafs.begin(); it != fafs.end(); it++)
     {
@@ -1726,6 +1833,18 @@ void MegaClient::logout()
 
     fafcs.clear();
 
+    for (faf_map::iterator it = fafcached.begin(); it != fafcached.end(); it++)
+    {
+        delete it->second;
+    }
+
+    fafcached.clear();
+
+    if (facache)
+    {
+        facache->reset();
+    }
+
     pendingfa.clear();
 
     // erase master key & session ID
@@ -1981,6 +2100,21 @@ void MegaClient::finalizesc(bool complete)
 
 }
 
+// incremental file attribute fetches are parsed as soon as data arrives
+bool MegaClient::fafcreceived()
+{
+    for (fafc_map::iterator it = fafcs.begin(); it != fafcs.end(); it++)
+    {
+        if (it->second->req.incremental && it->second->req.status == REQ_INFLIGHT
+         && it->second->req.bufpos != it->second->parsed)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
 // notify the application of the request failure and remove records no longer needed
 void MegaClient::faf_failed(int fac)
 {
@@ -2049,12 +2183,35 @@ error MegaClient::getfa(Node* n, fatype t, int cancel)
             return API_OK;
         }
 
+        if ((it = fafcached.find(fah)) != fafcached.end())
+        {
+            delete it->second;
+            fafcached.erase(it);
+            return API_OK;
+        }
+
         return API_ENOENT;
     }
     else
     {
         int c = atoi(n->fileattrstring.c_str() + pp);
 
+        // cached? (delivered from exec())
+        if (facache && !fafs.count(fah) && !fafcached.count(fah))
+        {
+            FileAttributeFetch* f = new FileAttributeFetch(n->nodehandle, t, c, reqtag);
+
+            openfatable();
+
+            if (facache->get(n->nodehandle, t, fah, &f->data))
+            {
+                fafcached[fah] = f;
+                return API_OK;
+            }
+
+            delete f;
+        }
+
         // add file atttribute cluster channel and set cluster reference node handle
         FileAttributeFetchChannel** fafcp = &fafcs[c];
 
@@ -2077,6 +2234,33 @@ error MegaClient::getfa(Node* n, fatype t, int cancel)
     }
 }
 
+void MegaClient::setfacache(size_t maxmemory, m_off_t maxdisk)
+{
+    delete facache;
+    facache = NULL;
+
+    if (maxmemory || maxdisk)
+    {
+        facache = new FileAttributeCache(maxmemory, maxdisk);
+    }
+}
+
+// the table is shared by all sessions of the user (records are encrypted
+// with the master key)
+void MegaClient::openfatable()
+{
+    if (facache && facache->maxdisk && dbaccess && !facache->attached() && me != UNDEF)
+    {
+        char buf[sizeof me * 4 / 3 + 4];
+        string dbname = "fa_";
+
+        Base64::btoa((const byte*)&me, sizeof me, buf);
+        dbname.append(buf);
+
+        facache->attach(dbaccess->open(fsaccess, &dbname), &key);
+    }
+}
+
 // build pending attribute string for this handle and remove
 void MegaClient::pendingattrstring(handle h, string* fa)
 {
@@ -2100,16 +2284,74 @@ void MegaClient::putfa(handle th, fatype t, SymmCipher* key, string* data)
     data->resize((data->size() + SymmCipher::BLOCKSIZE - 1) & -SymmCipher::BLOCKSIZE);
     key->cbc_encrypt((byte*)data->data(), data->size());
 
-    newfa.push_back(new HttpReqCommandPutFA(this, th, t, data));
+    queueputfa(new HttpReqCommandPutFA(this, th, t, data));
 
-    // no other file attribute storage request currently in progress? POST this one.
-    if (curfa == newfa.end())
+    // POST it right away if below the concurrency limit
+    dispatchputfa();
+}
+
+void MegaClient::queueputfa(HttpReqCommandPutFA* fa)
+{
+    handlepair_set::iterator uit = uhnh.lower_bound(pair<handle, handle>(fa->th, 0));
+
+    if ((uit != uhnh.end() && uit->first == fa->th) || nodebyhandle(fa->th))
     {
-        curfa = newfa.begin();
-        reqs[r].add(*curfa);
+        readyfa.push_back(fa);
+    }
+    else
+    {
+        // moved to readyfa upon upload completion
+        uploadfa[fa->th].push_back(fa);
+        uploadfacount++;
     }
 }
 
+void MegaClient::dispatchputfa()
+{
+    HttpReqCommandPutFA* fa;
+
+    // failed writes rejoin the queues once their backoff has expired
+    while (retryfa.size() && retryfa.front()->bt.armed())
+    {
+        fa = retryfa.front();
+        retryfa.pop_front();
+        queueputfa(fa);
+    }
+
+    // attributes that can be attached immediately (existing node or
+    // completed upload) take precedence over those of uploads in progress
+    while (activefa.size() < MAXPUTFA && (readyfa.size() || uploadfacount))
+    {
+        if (readyfa.size())
+        {
+            fa = readyfa.front();
+            readyfa.pop_front();
+        }
+        else
+        {
+            handleputfa_map::iterator it = uploadfa.begin();
+
+            fa = it->second.front();
+            it->second.pop_front();
+            uploadfacount--;
+
+            if (!it->second.size())
+            {
+                uploadfa.erase(it);
+            }
+        }
+
+        fa->status = REQ_INFLIGHT;
+        reqs[r].add(fa);
+        activefa.push_back(fa);
+    }
+}
+
+unsigned MegaClient::queuedputfa() const
+{
+    return readyfa.size() + uploadfacount + retryfa.size() + activefa.size();
+}
+
 // has the limit of concurrent transfer tslots been reached?
 bool MegaClient::slotavail() const
 {
@@ -2785,6 +3027,11 @@ error MegaClient::setattr(Node* n, const char** newattr)
         return API_EACCESS;
     }
 
+    if (!n->nodecipher())
+    {
+        return API_EKEY;
+    }
+
     if (newattr)
     {
         while (*newattr)
@@ -2794,6 +3041,9 @@ error MegaClient::setattr(Node* n, const char** newattr)
         }
     }
 
+    // (the display name may have changed)
+    n->indexname();
+
     n->changed.attrs = true;
     notifynode(n);
 
@@ -3120,7 +3370,8 @@ uint64_t MegaClient::stringhash64(string* s, SymmCipher* c)
 }
 
 // read and add/verify node array
-int MegaClient::readnodes(JSON* j, int notify, putsource_t source, NewNode* nn, int tag)
+// if added is supplied, the nodes created are appended to it
+int MegaClient::readnodes(JSON* j, int notify, putsource_t source, NewNode* nn, int tag, node_vector* added)
 {
     if (!j->enterarray())
     {
@@ -3332,13 +3583,18 @@ int MegaClient::readnodes(JSON* j, int notify, putsource_t source, NewNode* nn,
                     sts = ts;
                 }
 
-                n = new Node(this, &dp, h, ph, t, s, u, fas.c_str(), ts, ts + tmd);
+                n = new(this) Node(this, &dp, h, ph, t, s, u, fas.c_str(), ts, ts + tmd);
 
                 n->tag = tag;
 
                 Node::copystring(&n->attrstring, a);
                 Node::copystring(&n->keystring, k);
 
+                if (added)
+                {
+                    added->push_back(n);
+                }
+
                 if (!ISUNDEF(su))
                 {
                     newshares.push_back(new NewShare(h, 0, su, rl, sts, buf));
@@ -3373,6 +3629,17 @@ int MegaClient::readnodes(JSON* j, int notify, putsource_t source, NewNode* nn,
 
                     // FIXME: only do this for in-flight FA writes
                     uhnh.insert(pair<handle, handle>(uh, h));
+
+                    // queued file attributes for this upload can now be
+                    // attached right away
+                    handleputfa_map::iterator fit = uploadfa.find(uh);
+
+                    if (fit != uploadfa.end())
+                    {
+                        uploadfacount -= fit->second.size();
+                        readyfa.splice(readyfa.end(), fit->second);
+                        uploadfa.erase(fit);
+                    }
                 }
 
                 i++;
@@ -3565,11 +3832,30 @@ int MegaClient::applykeys()
 
     // FIXME: rather than iterating through the whole node set, maintain subset
     // with missing keys
-    for (node_map::iterator it = nodes.begin(); it != nodes.end(); it++)
+    if (workers->numthreads())
+    {
+        // unwrap symmetric keys and decrypt attributes on the worker threads
+        // (in rounds to bound the memory footprint)
+        vector<WorkerJob*> jobs;
+
+        for (node_map::iterator it = nodes.begin(); it != nodes.end(); it++)
+        {
+            if (queuenodekey(it->second, &jobs))
+            {
+                t++;
+            }
+        }
+
+        runnodekeyjobs(&jobs);
+    }
+    else
     {
-        if (it->second->applykey())
+        for (node_map::iterator it = nodes.begin(); it != nodes.end(); it++)
         {
-            t++;
+            if (it->second->applykey())
+            {
+                t++;
+            }
         }
     }
 
@@ -3588,6 +3874,84 @@ int MegaClient::applykeys()
     return t;
 }
 
+// apply the keys of the supplied nodes only (e.g. while they are streamed in)
+int MegaClient::applykeys(node_vector* v)
+{
+    int t = 0;
+
+    if (workers->numthreads())
+    {
+        vector<WorkerJob*> jobs;
+
+        for (node_vector::iterator it = v->begin(); it != v->end(); it++)
+        {
+            if (queuenodekey(*it, &jobs))
+            {
+                t++;
+            }
+        }
+
+        runnodekeyjobs(&jobs);
+    }
+    else
+    {
+        for (node_vector::iterator it = v->begin(); it != v->end(); it++)
+        {
+            if ((*it)->applykey())
+            {
+                t++;
+            }
+        }
+    }
+
+    return t;
+}
+
+// add node to the current NodeKeyJob (running a full round of jobs first) -
+// returns false if the node's key cannot be applied yet
+bool MegaClient::queuenodekey(Node* n, vector<WorkerJob*>* jobs)
+{
+    SymmCipher* sc;
+    const char* k;
+
+    if (!n->keystring.length() || !(k = n->findkey(&sc)))
+    {
+        return false;
+    }
+
+    NodeKeyJob* job = jobs->size() ? (NodeKeyJob*)jobs->back() : NULL;
+
+    if (!job || job->items.size() >= NodeKeyJob::MAXITEMS)
+    {
+        if (jobs->size() >= 4 * (workers->numthreads() + 1))
+        {
+            runnodekeyjobs(jobs);
+        }
+
+        job = new NodeKeyJob;
+        jobs->push_back(job);
+    }
+
+    if (!job->add(n, k, sc))
+    {
+        n->applykey();
+    }
+
+    return true;
+}
+
+void MegaClient::runnodekeyjobs(vector<WorkerJob*>* jobs)
+{
+    workers->runbatch(jobs, this);
+
+    for (unsigned i = 0; i < jobs->size(); i++)
+    {
+        delete (*jobs)[i];
+    }
+
+    jobs->clear();
+}
+
 // user/contact list
 bool MegaClient::readusers(JSON* j)
 {
@@ -4632,45 +4996,102 @@ bool MegaClient::fetchsc(DbTable* sctable)
     Node* n;
     User* u;
     node_vector dp;
+    vector<WorkerJob*> jobs;
+    CacheRecordJob* job = NULL;
+    unsigned maxjobs = 4 * (workers->numthreads() + 1);
+    bool more = true;
+    bool success = true;
 
     app->debug_log("Loading session from local cache");
 
     sctable->rewind();
 
-    while (sctable->next(&id, &data, &key))
+    while (more && success)
     {
-        switch (id & 15)
+        // decrypt and decode a round of records on the worker threads...
+        while ((more = sctable->next(&id, &data, NULL)))
         {
-            case CACHEDSCSN:
-                if (data.size() != sizeof cachedscsn)
-                {
-                    return false;
-                }
-                break;
+            if (!job)
+            {
+                job = new CacheRecordJob(&key);
+                jobs.push_back(job);
+            }
 
-            case CACHEDNODE:
-                if ((n = Node::unserialize(this, &data, &dp)))
-                {
-                    n->dbid = id;
-                }
-                else
+            job->add(id, &data);
+
+            if (job->items.size() >= CacheRecordJob::MAXRECORDS)
+            {
+                job = NULL;
+
+                if (jobs.size() >= maxjobs)
                 {
-                    app->debug_log("Failed - node record read error");
-                    return false;
+                    break;
                 }
-                break;
+            }
+        }
+
+        workers->runbatch(&jobs, this);
+
+        // ...then instantiate them in their original order
+        for (unsigned i = 0; i < jobs.size(); i++)
+        {
+            CacheRecordJob* j = (CacheRecordJob*)jobs[i];
 
-            case CACHEDUSER:
-                if ((u = User::unserialize(this, &data)))
+            for (unsigned k = 0; success && k < j->items.size(); k++)
+            {
+                CacheRecordJob::Item* item = &j->items[k];
+
+                if (!item->decrypted)
                 {
-                    u->dbid = id;
+                    app->debug_log("Failed - record decryption error");
+                    success = false;
+                    break;
                 }
-                else
+
+                switch (item->id & 15)
                 {
-                    app->debug_log("Failed - user record read error");
-                    return false;
+                    case CACHEDSCSN:
+                        if (item->data.size() != sizeof cachedscsn)
+                        {
+                            success = false;
+                        }
+                        break;
+
+                    case CACHEDNODE:
+                        if (item->decoded && (n = Node::unserialize(this, &item->node, &dp)))
+                        {
+                            n->dbid = item->id;
+                        }
+                        else
+                        {
+                            app->debug_log("Failed - node record read error");
+                            success = false;
+                        }
+                        break;
+
+                    case CACHEDUSER:
+                        if ((u = User::unserialize(this, &item->data)))
+                        {
+                            u->dbid = item->id;
+                        }
+                        else
+                        {
+                            app->debug_log("Failed - user record read error");
+                            success = false;
+                        }
                 }
+            }
+
+            delete j;
         }
+
+        jobs.clear();
+        job = NULL;
+    }
+
+    if (!success)
+    {
+        return false;
     }
 
     // any child nodes arrived before their parents?
@@ -4721,18 +5142,9 @@ void MegaClient::fetchnodes()
     }
 }
 
-void MegaClient::purgenodesusersabortsc()
+// delete all nodes along with their pending shares and notifications
+void MegaClient::purgenodes()
 {
-    app->clearing();
-
-    for (sync_list::iterator it = syncs.begin(); it != syncs.end(); )
-    {
-        (*it)->changestate(SYNC_CANCELED);
-        delete *(it++);
-    }
-
-    syncs.clear();
-
     for (node_map::iterator it = nodes.begin(); it != nodes.end(); it++)
     {
         delete it->second;
@@ -4741,6 +5153,9 @@ void MegaClient::purgenodesusersabortsc()
     todebris.clear();
     nodes.clear();
 
+    // return the node memory to the system in bulk
+    nodeslab->purge();
+
     for (newshare_list::iterator it = newshares.begin(); it != newshares.end(); it++)
     {
         delete *it;
@@ -4749,6 +5164,24 @@ void MegaClient::purgenodesusersabortsc()
     newshares.clear();
 
     nodenotify.clear();
+}
+
+void MegaClient::purgenodesusersabortsc()
+{
+    app->clearing();
+
+    for (sync_list::iterator it = syncs.begin(); it != syncs.end(); )
+    {
+        (*it)->changestate(SYNC_CANCELED);
+        delete *(it++);
+    }
+
+    syncs.clear();
+
+    purgenodes();
+
+    localnodeslab->purge();
+
     usernotify.clear();
     users.clear();
     uhindex.clear();
@@ -5124,7 +5557,16 @@ void MegaClient::syncup(LocalNode* l, dstime* nds)
     string localname;
     string tmpname;
 
-    if (l->node)
+    // large remote folders without escaped names are looked up through their
+    // name index instead of building the child hash
+    namenode_map* childnames = l->node ? l->node->namedchildren() : NULL;
+
+    if (childnames && l->node->escapedchildnames)
+    {
+        childnames = NULL;
+    }
+
+    if (l->node && !childnames)
     {
         // corresponding remote node present: build child hash - nameclash
         // resolution: use newest version
@@ -5153,6 +5595,27 @@ void MegaClient::syncup(LocalNode* l, dstime* nds)
 
         localname = *lit->first;
         fsaccess->local2name(&localname);
+
+        if (childnames)
+        {
+            // apply the same nameclash resolution to the indexed aliases
+            // (display names are placeholders for undecrypted/unnamed nodes)
+            pair<namenode_map::iterator, namenode_map::iterator> range = childnames->equal_range(localname);
+
+            nchildren.clear();
+
+            for (namenode_map::iterator nit = range.first; nit != range.second; nit++)
+            {
+                if ((nit->second->syncdeleted == SYNCDEL_NONE)
+                        && !nit->second->attrstring.size()
+                        && ((ait = nit->second->attrs.map.find('n')) != nit->second->attrs.map.end())
+                        && ait->second == localname)
+                {
+                    addchild(&nchildren, &localname, nit->second, &strings);
+                }
+            }
+        }
+
         rit = nchildren.find(&localname);
 
         // do we have a corresponding remote child?
@@ -5254,7 +5717,7 @@ void MegaClient::syncup(LocalNode* l, dstime* nds)
                     if (t)
                     {
                         ll->sync->localbytes -= ll->size;
-                        ll->genfingerprint(fa);
+                        ll->sync->genfingerprint(ll, fa);
                         ll->sync->localbytes += ll->size;                        
 
                         ll->sync->statecacheadd(ll);
@@ -5771,6 +6234,7 @@ error MegaClient::addsync(string* rootpath, const char* debris, string* localdeb
 
             if (sync->scan(rootpath, fa))
             {
+                sync->startprefetch();
                 e = API_OK;
             }
             else
@@ -43,6 +43,10 @@ Node::Node(MegaClient* cclient, node_vector* dp, handle h, handle ph,
 
     parent = NULL;
 
+    childnames = NULL;
+    escapedchildnames = 0;
+    nameindexed = false;
+
     localnode = NULL;
     syncget = NULL;
 
@@ -60,6 +64,7 @@ Node::Node(MegaClient* cclient, node_vector* dp, handle h, handle ph,
     ctime = ts;
 
     inshare = NULL;
+    outshares = NULL;
     sharekey = NULL;
 
     removed = 0;
@@ -69,7 +74,7 @@ Node::Node(MegaClient* cclient, node_vector* dp, handle h, handle ph,
     {
         Node* p;
 
-        client->nodes[h] = this;
+        client->nodes.set(h, this);
 
         // folder link access: first returned record defines root node and
         // identity
@@ -116,22 +121,36 @@ Node::~Node()
     }
 
     // delete outshares, including pointers from users for this node
-    for (share_map::iterator it = outshares.begin(); it != outshares.end(); it++)
+    if (outshares)
     {
-        delete it->second;
+        for (share_map::iterator it = outshares->begin(); it != outshares->end(); it++)
+        {
+            delete it->second;
+        }
+
+        delete outshares;
+    }
+
+    if (client && client->tmpnodecipherhandle == nodehandle)
+    {
+        client->tmpnodecipherhandle = UNDEF;
     }
 
     // remove from parent's children
     if (parent)
     {
+        unindexname();
         parent->children.erase(child_it);
     }
 
+    delete childnames;
+
     // delete child-parent associations (normally not used, as nodes are
     // deleted bottom-up)
     for (node_list::iterator it = children.begin(); it != children.end(); it++)
     {
         (*it)->parent = NULL;
+        (*it)->nameindexed = false;
     }
 
     delete inshare;
@@ -153,36 +172,75 @@ Node::~Node()
 // mismatch vector
 Node* Node::unserialize(MegaClient* client, string* d, node_vector* dp)
 {
-    handle h, ph;
-    nodetype_t t;
-    m_off_t s;
-    handle u;
-    const byte* k = NULL;
-    const char* fa;
-    m_time_t tm;
-    m_time_t ts;
-    const byte* skey;
+    NodeRecord r;
+
+    if (!r.decode(d))
+    {
+        return NULL;
+    }
+
+    return unserialize(client, &r, dp);
+}
+
+// create Node object from decoded record
+Node* Node::unserialize(MegaClient* client, NodeRecord* r, node_vector* dp)
+{
+    Node* n = new(client) Node(client, dp, r->h, r->ph, r->type, r->size, r->owner,
+                               r->fileattrstring, r->ctime, r->clienttimestamp);
+
+    if (r->key)
+    {
+        n->setkey(r->key);
+    }
+
+    if (r->numshares)
+    {
+        const char* ptr = r->shares;
+        short numshares = r->numshares;
+
+        // read inshare or outshares
+        while (Share::unserialize(client,
+                                  (numshares > 0) ? -1 : 0,
+                                  r->h, r->sharekey, &ptr, r->end)
+               && numshares > 0
+               && --numshares);
+    }
+
+    n->attrs.map.swap(r->attrs.map);
+
+    n->setfingerprint();
+
+    return n;
+}
+
+// parse serialized node (does not touch engine state - the record's pointers
+// refer to d)
+bool NodeRecord::decode(const string* d)
+{
     const char* ptr = d->data();
-    const char* end = ptr + d->size();
     unsigned short ll;
-    Node* n;
+    m_off_t s;
     int i;
 
-    if (ptr + sizeof s + 2 * MegaClient::NODEHANDLE + MegaClient::USERHANDLE + 2 * sizeof tm + sizeof ll > end)
+    end = ptr + d->size();
+
+    if (ptr + sizeof s + 2 * MegaClient::NODEHANDLE + MegaClient::USERHANDLE + 2 * sizeof(time_t) + sizeof ll > end)
     {
-        return NULL;
+        return false;
     }
 
     s = MemAccess::get<m_off_t>(ptr);
     ptr += sizeof s;
 
+    size = s;
+
     if (s < 0 && s >= -MAILNODE)
     {
-        t = (nodetype_t)-s;
+        type = (nodetype_t)-s;
     }
     else
     {
-        t = FILENODE;
+        type = FILENODE;
     }
 
     h = 0;
@@ -198,43 +256,45 @@ Node* Node::unserialize(MegaClient* client, string* d, node_vector* dp)
         ph = UNDEF;
     }
 
-    memcpy((char*)&u, ptr, MegaClient::USERHANDLE);
+    memcpy((char*)&owner, ptr, MegaClient::USERHANDLE);
     ptr += MegaClient::USERHANDLE;
 
     // FIME: use m_time_t / Serialize64 instead
-    tm = (uint32_t)MemAccess::get<time_t>(ptr);
+    clienttimestamp = (uint32_t)MemAccess::get<time_t>(ptr);
     ptr += sizeof(time_t);
 
-    ts = (uint32_t)MemAccess::get<time_t>(ptr);
+    ctime = (uint32_t)MemAccess::get<time_t>(ptr);
     ptr += sizeof(time_t);
 
-    if ((t == FILENODE) || (t == FOLDERNODE))
+    key = NULL;
+
+    if ((type == FILENODE) || (type == FOLDERNODE))
     {
-        int keylen = ((t == FILENODE) ? FILENODEKEYLENGTH + 0 : FOLDERNODEKEYLENGTH + 0);
+        int keylen = ((type == FILENODE) ? FILENODEKEYLENGTH + 0 : FOLDERNODEKEYLENGTH + 0);
 
         if (ptr + keylen + 8 + sizeof(short) > end)
         {
-            return NULL;
+            return false;
         }
 
-        k = (const byte*)ptr;
+        key = (const byte*)ptr;
         ptr += keylen;
     }
 
-    if (t == FILENODE)
+    if (type == FILENODE)
     {
         ll = MemAccess::get<unsigned short>(ptr);
         ptr += sizeof ll;
         if ((ptr + ll > end) || ptr[ll])
         {
-            return NULL;
+            return false;
         }
-        fa = ptr;
+        fileattrstring = ptr;
         ptr += ll;
     }
     else
     {
-        fa = NULL;
+        fileattrstring = NULL;
     }
 
     for (i = 8; i--;)
@@ -247,56 +307,40 @@ Node* Node::unserialize(MegaClient* client, string* d, node_vector* dp)
 
     if (i >= 0)
     {
-        return NULL;
+        return false;
     }
 
-    short numshares = MemAccess::get<short>(ptr);
+    numshares = MemAccess::get<short>(ptr);
     ptr += sizeof(numshares);
 
     if (numshares)
     {
         if (ptr + SymmCipher::KEYLENGTH > end)
         {
-            return 0;
+            return false;
         }
 
-        skey = (const byte*)ptr;
+        sharekey = (const byte*)ptr;
         ptr += SymmCipher::KEYLENGTH;
-    }
-    else
-    {
-        skey = NULL;
-    }
 
-    n = new Node(client, dp, h, ph, t, s, u, fa, ts, tm);
+        // one inshare or numshares outshares
+        shares = ptr;
+        ptr += ((numshares > 0) ? numshares : 1) * Share::SERIALIZEDSIZE;
 
-    if (k)
-    {
-        n->setkey(k);
+        if (ptr > end)
+        {
+            return false;
+        }
     }
-
-    if (numshares)
+    else
     {
-        // read inshare or outshares
-        while (Share::unserialize(client,
-                                  (numshares > 0) ? -1 : 0,
-                                  h, skey, &ptr, end)
-               && numshares > 0
-               && --numshares);
+        sharekey = NULL;
+        shares = NULL;
     }
 
-    ptr = n->attrs.unserialize(ptr);
+    ptr = attrs.unserialize(ptr);
 
-    n->setfingerprint();
-
-    if (ptr == end)
-    {
-        return n;
-    }
-    else
-    {
-        return NULL;
-    }
+    return ptr == end;
 }
 
 // serialize node - nodes with pending or RSA keys are unsupported
@@ -377,7 +421,7 @@ bool Node::serialize(string* d)
     }
     else
     {
-        numshares = (short)outshares.size();
+        numshares = outshares ? (short)outshares->size() : 0;
     }
 
     d->append((char*)&numshares, sizeof numshares);
@@ -392,7 +436,7 @@ bool Node::serialize(string* d)
         }
         else
         {
-            for (share_map::iterator it = outshares.begin(); it != outshares.end(); it++)
+            for (share_map::iterator it = outshares->begin(); it != outshares->end(); it++)
             {
                 it->second->serialize(d);
             }
@@ -454,30 +498,57 @@ byte* Node::decryptattr(SymmCipher* key, const char* attrstring, int attrstrlen)
 
 // decrypt attributes and build attribute hash
 void Node::setattr()
+{
+    SymmCipher* cipher;
+
+    if (attrstring.size() && (cipher = nodecipher())
+     && parseattr(cipher, &attrstring, &attrs.map))
+    {
+        applyattr();
+    }
+}
+
+// decrypt attribute string and merge its attributes into map
+bool Node::parseattr(SymmCipher* cipher, const string* attrstring, attr_map* map)
 {
     byte* buf;
 
-    if (attrstring.size() && (buf = decryptattr(&key, attrstring.c_str(), attrstring.size())))
+    if (!(buf = decryptattr(cipher, attrstring->c_str(), attrstring->size())))
     {
-        JSON json;
-        nameid name;
-        string* t;
+        return false;
+    }
 
-        json.begin((char*)buf + 5);
+    JSON json;
+    nameid name;
+    string* t;
 
-        while ((name = json.getnameid()) != EOO && json.storeobject((t = &attrs.map[name])))
-        {
-            JSON::unescape(t);
-            if(name == 'n')
-                client->fsaccess->normalize(t);
-        }
+    json.begin((char*)buf + 5);
 
-        setfingerprint();
+    while ((name = json.getnameid()) != EOO && json.storeobject((t = &(*map)[name])))
+    {
+        JSON::unescape(t);
+    }
 
-        delete[] buf;
+    delete[] buf;
 
-        attrstring.clear();
+    return true;
+}
+
+void Node::applyattr()
+{
+    attr_map::iterator it = attrs.map.find('n');
+
+    if (it != attrs.map.end())
+    {
+        client->fsaccess->normalize(&it->second);
     }
+
+    setfingerprint();
+
+    attrstring.clear();
+
+    // display name may have changed
+    indexname();
 }
 
 // if present, configure FileFingerprint from attributes
@@ -551,6 +622,31 @@ bool Node::applykey()
         return false;
     }
 
+    SymmCipher* sc;
+    const char* k = findkey(&sc);
+
+    if (!k)
+    {
+        return false;
+    }
+
+    byte key[FILENODEKEYLENGTH];
+
+    if (client->decryptkey(k, key,
+                           (type == FILENODE)
+                               ? FILENODEKEYLENGTH + 0
+                               : FOLDERNODEKEYLENGTH + 0,
+                           sc, 0, nodehandle))
+    {
+        keystring.clear();
+        setkey(key);
+    }
+
+    return true;
+}
+
+const char* Node::findkey(SymmCipher** scp)
+{
     int l = -1, t = 0;
     handle h;
     const char* k = NULL;
@@ -604,23 +700,13 @@ bool Node::applykey()
         }
         else
         {
-            return false;
+            return NULL;
         }
     }
 
-    byte key[FILENODEKEYLENGTH];
-
-    if (client->decryptkey(k, key,
-                           (type == FILENODE)
-                               ? FILENODEKEYLENGTH + 0
-                               : FOLDERNODEKEYLENGTH + 0,
-                           sc, 0, nodehandle))
-    {
-        keystring.clear();
-        setkey(key);
-    }
+    *scp = sc;
 
-    return true;
+    return k;
 }
 
 // update node key and decrypt attributes
@@ -631,10 +717,97 @@ void Node::setkey(const byte* newkey)
         nodekey.assign((char*)newkey, (type == FILENODE) ? FILENODEKEYLENGTH + 0 : FOLDERNODEKEYLENGTH + 0);
     }
 
-    key.setkey((const byte*)nodekey.data(), type);
+    // (the expanded key is stale)
+    if (client && client->tmpnodecipherhandle == nodehandle)
+    {
+        client->tmpnodecipherhandle = UNDEF;
+    }
+
     setattr();
 }
 
+SymmCipher* Node::nodecipher()
+{
+    if (nodekey.size() != ((type == FILENODE) ? FILENODEKEYLENGTH + 0 : FOLDERNODEKEYLENGTH + 0))
+    {
+        return NULL;
+    }
+
+    if (client->tmpnodecipherhandle != nodehandle)
+    {
+        client->tmpnodecipher.setkey((const byte*)nodekey.data(), type);
+        client->tmpnodecipherhandle = nodehandle;
+    }
+
+    return &client->tmpnodecipher;
+}
+
+// children by display name (large folders only)
+namenode_map* Node::namedchildren()
+{
+    if (!childnames && children.size() >= NAMEINDEXTHRESHOLD)
+    {
+        childnames = new namenode_map;
+
+        for (node_list::iterator it = children.begin(); it != children.end(); it++)
+        {
+            (*it)->indexname();
+        }
+    }
+
+    return childnames;
+}
+
+void Node::indexname()
+{
+    if (!parent || !parent->childnames)
+    {
+        return;
+    }
+
+    unindexname();
+
+    const char* name = displayname();
+
+    childname_it = parent->childnames->insert(namenode_map::value_type(name, this));
+    nameindexed = true;
+
+    if (strchr(name, '%'))
+    {
+        parent->escapedchildnames++;
+    }
+}
+
+void Node::unindexname()
+{
+    if (nameindexed)
+    {
+        if (childname_it->first.find('%') + 1)
+        {
+            parent->escapedchildnames--;
+        }
+
+        parent->childnames->erase(childname_it);
+        nameindexed = false;
+    }
+}
+
+void* Node::operator new(size_t size, MegaClient* client)
+{
+    return client ? client->nodeslab->alloc(size) : SlabAllocator::heapalloc(size);
+}
+
+// (only invoked if the constructor throws)
+void Node::operator delete(void* ptr, MegaClient*)
+{
+    SlabAllocator::release(ptr);
+}
+
+void Node::operator delete(void* ptr)
+{
+    SlabAllocator::release(ptr);
+}
+
 // returns whether node was moved
 bool Node::setparent(Node* p)
 {
@@ -645,6 +818,7 @@ bool Node::setparent(Node* p)
 
     if (parent)
     {
+        unindexname();
         parent->children.erase(child_it);
     }
 
@@ -652,6 +826,11 @@ bool Node::setparent(Node* p)
 
     child_it = parent->children.insert(parent->children.end(), this);
 
+    if (parent->childnames)
+    {
+        indexname();
+    }
+
     // if we are moving an entire sync, don't cancel GET transfers
     if (!localnode || localnode->parent)
     {
@@ -950,6 +1129,21 @@ void LocalNode::setfsid(handle newfsid)
 
 }
 
+void* LocalNode::operator new(size_t size, MegaClient* client)
+{
+    return client->localnodeslab->alloc(size);
+}
+
+void LocalNode::operator delete(void* ptr, MegaClient*)
+{
+    SlabAllocator::release(ptr);
+}
+
+void LocalNode::operator delete(void* ptr)
+{
+    SlabAllocator::release(ptr);
+}
+
 LocalNode::~LocalNode()
 {
     if (sync->state == SYNC_ACTIVE || sync->state == SYNC_INITIALSCAN)
@@ -1244,7 +1438,7 @@ LocalNode* LocalNode::unserialize(Sync* sync, string* d)
         }
     }
 
-    LocalNode* l = new LocalNode();
+    LocalNode* l = new(sync->client) LocalNode();
 
     l->type = type;
     l->size = size;
@@ -1268,4 +1462,128 @@ LocalNode* LocalNode::unserialize(Sync* sync, string* d)
     return l;
 }
 
+
+bool NodeKeyJob::add(Node* n, const char* k, SymmCipher* sc)
+{
+    const char* ptr = k;
+
+    // RSA-encrypted keys are left to MegaClient::decryptkey()
+    while (*ptr && *ptr != '"' && *ptr != '/')
+    {
+        ptr++;
+    }
+
+    if (ptr - k > 4 * FILENODEKEYLENGTH / 3 + 1)
+    {
+        return false;
+    }
+
+    items.resize(items.size() + 1);
+
+    Item* item = &items.back();
+
+    item->node = n;
+    item->k = k;
+    memcpy(item->sk, sc->key, sizeof item->sk);
+    item->keyok = false;
+    item->attrok = false;
+
+    return true;
+}
+
+// (the engine thread is blocked in WorkerPool::runbatch() while this runs, so
+// the nodes can be read safely)
+void NodeKeyJob::run()
+{
+    SymmCipher sc, nc;
+    const byte* sk = NULL;
+
+    for (unsigned i = 0; i < items.size(); i++)
+    {
+        Item* item = &items[i];
+        Node* n = item->node;
+        int l = (n->type == FILENODE) ? FILENODEKEYLENGTH + 0 : FOLDERNODEKEYLENGTH + 0;
+
+        // most nodes are encrypted with the same key - expand only on change
+        if (!sk || memcmp(sk, item->sk, sizeof item->sk))
+        {
+            sc.setkey(item->sk);
+            sk = item->sk;
+        }
+
+        if (Base64::atob(item->k, item->key, l) != l)
+        {
+            continue;
+        }
+
+        sc.ecb_decrypt(item->key, l);
+        item->keyok = true;
+
+        if (n->attrstring.size())
+        {
+            nc.setkey(item->key, n->type);
+            item->attrok = Node::parseattr(&nc, &n->attrstring, &item->attrs);
+        }
+    }
+}
+
+void NodeKeyJob::complete(MegaClient* client)
+{
+    for (unsigned i = 0; i < items.size(); i++)
+    {
+        Item* item = &items[i];
+        Node* n = item->node;
+
+        if (!item->keyok)
+        {
+            client->app->debug_log("Corrupt or invalid symmetric node key");
+            continue;
+        }
+
+        n->keystring.clear();
+        n->nodekey.assign((char*)item->key, (n->type == FILENODE) ? FILENODEKEYLENGTH + 0 : FOLDERNODEKEYLENGTH + 0);
+
+        if (client->tmpnodecipherhandle == n->nodehandle)
+        {
+            client->tmpnodecipherhandle = UNDEF;
+        }
+
+        if (item->attrok)
+        {
+            for (attr_map::iterator it = item->attrs.begin(); it != item->attrs.end(); it++)
+            {
+                n->attrs.map[it->first].swap(it->second);
+            }
+
+            n->applyattr();
+        }
+    }
+}
+
+CacheRecordJob::CacheRecordJob(SymmCipher* k) : key(k->key)
+{
+}
+
+void CacheRecordJob::add(uint32_t id, string* data)
+{
+    items.resize(items.size() + 1);
+
+    items.back().id = id;
+    items.back().data.swap(*data);
+}
+
+void CacheRecordJob::run()
+{
+    for (unsigned i = 0; i < items.size(); i++)
+    {
+        Item* item = &items[i];
+
+        // (record 0 is stored unencrypted)
+        item->decrypted = !item->id || PaddedCBC::decrypt(&item->data, &key);
+
+        item->decoded = item->decrypted
+                     && (item->id & 15) == MegaClient::CACHEDNODE
+                     && item->node.decode(&item->data);
+    }
+}
 } // namespace
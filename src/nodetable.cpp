@@ -0,0 +1,171 @@
+/**
+ * @file nodetable.cpp
+ * @brief Hash table mapping node handles to nodes
+ *
+ * (c) 2013-2014 by Mega Limited, Wellsford, New Zealand
+ *
+ * This file is part of the MEGA SDK - Client Access Engine.
+ *
+ * Applications using the MEGA API must present a valid application key
+ * and comply with the the rules set forth in the Terms of Service.
+ *
+ * The MEGA SDK is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @copyright Simplified (2-clause) BSD License.
+ *
+ * You should have received a copy of the license along with this
+ * program.
+ */
+
+#include "mega/nodetable.h"
+
+namespace mega {
+NodeTable::NodeTable()
+{
+    capacity = 0;
+    count = 0;
+    slots = NULL;
+}
+
+NodeTable::~NodeTable()
+{
+    delete[] slots;
+}
+
+NodeTable::iterator NodeTable::begin()
+{
+    return iterator(slots, slots + capacity);
+}
+
+NodeTable::iterator NodeTable::end()
+{
+    return iterator(slots + capacity, slots + capacity);
+}
+
+NodeTable::iterator NodeTable::find(handle h)
+{
+    if (count)
+    {
+        for (size_t i = home(h); slots[i].second; i = (i + 1) & (capacity - 1))
+        {
+            if (slots[i].first == h)
+            {
+                return iterator(slots + i, slots + capacity);
+            }
+        }
+    }
+
+    return end();
+}
+
+void NodeTable::set(handle h, Node* n)
+{
+    // keep the load factor below 3/4
+    if ((count + 1) * 4 > capacity * 3)
+    {
+        rehash(capacity ? capacity * 2 : 1024);
+    }
+
+    size_t i;
+
+    for (i = home(h); slots[i].second; i = (i + 1) & (capacity - 1))
+    {
+        if (slots[i].first == h)
+        {
+            slots[i].second = n;
+            return;
+        }
+    }
+
+    slots[i].first = h;
+    slots[i].second = n;
+    count++;
+}
+
+size_t NodeTable::erase(handle h)
+{
+    iterator it = find(h);
+
+    if (it == end())
+    {
+        return 0;
+    }
+
+    size_t i = &*it - slots;
+    size_t j = i;
+
+    // move subsequent entries of the probe sequence into the gap, unless
+    // they would end up before their home slot
+    for (;;)
+    {
+        j = (j + 1) & (capacity - 1);
+
+        if (!slots[j].second)
+        {
+            break;
+        }
+
+        size_t k = home(slots[j].first);
+
+        if ((j > i) ? (k <= i || k > j) : (k <= i && k > j))
+        {
+            slots[i] = slots[j];
+            i = j;
+        }
+    }
+
+    slots[i].second = NULL;
+    count--;
+
+    return 1;
+}
+
+void NodeTable::clear()
+{
+    delete[] slots;
+
+    capacity = 0;
+    count = 0;
+    slots = NULL;
+}
+
+void NodeTable::reserve(size_t n)
+{
+    size_t c = capacity ? capacity : 1024;
+
+    while (n * 4 > c * 3)
+    {
+        c *= 2;
+    }
+
+    if (c > capacity)
+    {
+        rehash(c);
+    }
+}
+
+void NodeTable::rehash(size_t newcapacity)
+{
+    value_type* oldslots = slots;
+    size_t oldcapacity = capacity;
+
+    slots = new value_type[newcapacity]();
+    capacity = newcapacity;
+
+    for (size_t i = 0; i < oldcapacity; i++)
+    {
+        if (oldslots[i].second)
+        {
+            size_t j;
+
+            for (j = home(oldslots[i].first); slots[j].second; j = (j + 1) & (capacity - 1));
+
+            slots[j] = oldslots[i];
+        }
+    }
+
+    delete[] oldslots;
+}
+} // namespace
@@ -31,6 +31,7 @@ namespace mega {
 PosixFileAccess::PosixFileAccess()
 {
     fd = -1;
+    mapped = NULL;
 
 #ifndef HAVE_FDOPENDIR
     dp = NULL;
@@ -48,6 +49,11 @@ PosixFileAccess::~PosixFileAccess()
     }
 #endif
 
+    if (mapped)
+    {
+        munmap(mapped, size);
+    }
+
     if (fd >= 0)
     {
         close(fd);
@@ -120,6 +126,21 @@ bool PosixFileAccess::fwrite(const byte* data, unsigned len, m_off_t pos)
 #endif
 }
 
+const byte* PosixFileAccess::fmap()
+{
+    if (!mapped && fd >= 0 && size > 0 && (m_off_t)(size_t)size == size)
+    {
+        void* p = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+
+        if (p != MAP_FAILED)
+        {
+            mapped = p;
+        }
+    }
+
+    return (const byte*)mapped;
+}
+
 bool PosixFileAccess::fopen(string* f, bool read, bool write)
 {
     struct stat statbuf;
@@ -151,7 +172,7 @@ bool PosixFileAccess::fopen(string* f, bool read, bool write)
     }
 #endif
 
-    if ((fd = open(f->c_str(), write ? (read ? O_RDWR : O_WRONLY | O_CREAT | O_TRUNC) : O_RDONLY, 0600)) >= 0)
+    if ((fd = open(f->c_str(), write ? (read ? O_RDWR | O_CREAT : O_WRONLY | O_CREAT | O_TRUNC) : O_RDONLY, 0600)) >= 0)
     {
         if (!fstat(fd, &statbuf))
         {
@@ -273,12 +294,7 @@ void PosixFileSystemAccess::addevents(Waiter* w, int flags)
 {
     if (notifyfd >= 0)
     {
-        PosixWaiter* pw = (PosixWaiter*)w;
-
-        FD_SET(notifyfd, &pw->rfds);
-        FD_SET(notifyfd, &pw->ignorefds);
-
-        pw->bumpmaxfd(notifyfd);
+        ((PosixWaiter*)w)->watchfd(notifyfd, PosixWaiter::WAITREAD, true);
     }
 }
 
@@ -292,7 +308,7 @@ int PosixFileSystemAccess::checkevents(Waiter* w)
     PosixWaiter* pw = (PosixWaiter*)w;
     string *ignore;
 
-    if (FD_ISSET(notifyfd, &pw->rfds))
+    if (pw->fdevents(notifyfd))
     {
         char buf[sizeof(struct inotify_event) + NAME_MAX + 1];
         int p, l;
@@ -37,27 +37,133 @@ CurlHttpIO::CurlHttpIO()
 
     contenttypebinary = curl_slist_append(NULL, "Content-Type: application/octet-stream");
     contenttypebinary = curl_slist_append(contenttypebinary, "Expect:");
+
+    // connections of completed requests stay open in the multi handle's
+    // connection cache (shared by all easy handles) for reuse by later
+    // requests to the same host - bound its size
+    curl_multi_setopt(curlm, CURLMOPT_MAXCONNECTS, 64L);
+
+    curl_multi_setopt(curlm, CURLMOPT_SOCKETFUNCTION, socket_callback);
+    curl_multi_setopt(curlm, CURLMOPT_SOCKETDATA, (void*)this);
+    curl_multi_setopt(curlm, CURLMOPT_TIMERFUNCTION, timer_callback);
+    curl_multi_setopt(curlm, CURLMOPT_TIMERDATA, (void*)this);
+
+    waiter = NULL;
+    curltimeoutds = ~(dstime)0;
+
+    newconnections = 0;
+    reusedconnections = 0;
+
+    // write_data() is invoked from curl_multi_socket_action()
+    syncput = true;
 }
 
 CurlHttpIO::~CurlHttpIO()
 {
+    curl_multi_cleanup(curlm);
+    curl_share_cleanup(curlsh);
+
+    curl_slist_free_all(contenttypejson);
+    curl_slist_free_all(contenttypebinary);
+
     curl_global_cleanup();
 }
 
+// record whether a completed request opened a new connection
+void CurlHttpIO::countconnection(CURL* curl)
+{
+    long connects = 0;
+
+    if (curl_easy_getinfo(curl, CURLINFO_NUM_CONNECTS, &connects) == CURLE_OK)
+    {
+        if (connects)
+        {
+            newconnections++;
+        }
+        else
+        {
+            reusedconnections++;
+        }
+    }
+}
+
 void CurlHttpIO::setuseragent(string* u)
 {
     useragent = u;
 }
 
-// wake up from cURL I/O
+// libcurl (un)registers a socket
+int CurlHttpIO::socket_callback(CURL*, curl_socket_t s, int what, void* userp, void*)
+{
+    CurlHttpIO* httpio = (CurlHttpIO*)userp;
+
+    if (what == CURL_POLL_REMOVE)
+    {
+        httpio->sockets.erase(s);
+
+        if (httpio->waiter)
+        {
+            httpio->waiter->unwatchfd(s);
+        }
+    }
+    else
+    {
+        int events = ((what & CURL_POLL_IN) ? PosixWaiter::WAITREAD : 0)
+                   | ((what & CURL_POLL_OUT) ? PosixWaiter::WAITWRITE : 0);
+
+        httpio->sockets[s] = events;
+
+        if (httpio->waiter)
+        {
+            httpio->waiter->watchfd(s, events);
+        }
+    }
+
+    return 0;
+}
+
+// libcurl requests a timeout (-1: none)
+int CurlHttpIO::timer_callback(CURLM*, long timeout_ms, void* userp)
+{
+    CurlHttpIO* httpio = (CurlHttpIO*)userp;
+
+    if (timeout_ms < 0)
+    {
+        httpio->curltimeoutds = ~(dstime)0;
+    }
+    else
+    {
+        httpio->curltimeoutds = Waiter::ds + (timeout_ms + 99) / 100;
+    }
+
+    return 0;
+}
+
+// wake up from cURL I/O: sockets are watched persistently, only the timeout
+// needs to be set per waiting cycle
 void CurlHttpIO::addevents(Waiter* w, int flags)
 {
-    int t;
     PosixWaiter* pw = (PosixWaiter*)w;
 
-    curl_multi_fdset(curlm, &pw->rfds, &pw->wfds, &pw->efds, &t);
+    if (waiter != pw)
+    {
+        waiter = pw;
 
-    pw->bumpmaxfd(t);
+        for (map<curl_socket_t, int>::iterator it = sockets.begin(); it != sockets.end(); it++)
+        {
+            waiter->watchfd(it->first, it->second);
+        }
+    }
+
+    if (curltimeoutds + 1)
+    {
+        dstime t = curltimeoutds > Waiter::ds ? curltimeoutds - Waiter::ds : 0;
+
+        if (t < w->maxds)
+        {
+            w->maxds = t;
+        }
+    }
 }
 
 // POST request to URL
@@ -146,7 +252,39 @@ bool CurlHttpIO::doio()
     CURLMsg *msg;
     int dummy;
 
-    curl_multi_perform(curlm, &dummy);
+    // hand the sockets reported ready by the waiter to libcurl (collected
+    // first, as libcurl may modify the socket set)
+    if (waiter)
+    {
+        vector<pair<curl_socket_t, int> > ready;
+
+        for (map<curl_socket_t, int>::iterator it = sockets.begin(); it != sockets.end(); it++)
+        {
+            int e = waiter->fdevents(it->first);
+
+            if (e)
+            {
+                ready.push_back(pair<curl_socket_t, int>(it->first,
+                                    ((e & PosixWaiter::WAITREAD) ? CURL_CSELECT_IN : 0)
+                                  | ((e & PosixWaiter::WAITWRITE) ? CURL_CSELECT_OUT : 0)
+                                  | ((e & PosixWaiter::WAITERROR) ? CURL_CSELECT_ERR : 0)));
+
+                // (consumed)
+                waiter->readyfds.erase(it->first);
+            }
+        }
+
+        for (unsigned i = 0; i < ready.size(); i++)
+        {
+            curl_multi_socket_action(curlm, ready[i].first, ready[i].second, &dummy);
+        }
+    }
+
+    if (curltimeoutds + 1 && curltimeoutds <= Waiter::ds)
+    {
+        curltimeoutds = ~(dstime)0;
+        curl_multi_socket_action(curlm, CURL_SOCKET_TIMEOUT, 0, &dummy);
+    }
 
     while ((msg = curl_multi_info_read(curlm, &dummy)))
     {
@@ -179,7 +317,7 @@ bool CurlHttpIO::doio()
 
                 // check httpstatus and response length
                 req->status = (req->httpstatus == 200
-                            && req->contentlength == (req->buf ? req->bufpos : req->in.size()))
+                            && req->contentlength == req->bufpos)
                              ? REQ_SUCCESS : REQ_FAILURE;
 
                 inetstatus(req->status);
@@ -193,8 +331,16 @@ bool CurlHttpIO::doio()
             }
         }
 
-        curl_multi_remove_handle(curlm, msg->easy_handle);
-        curl_easy_cleanup(msg->easy_handle);
+        // (msg does not survive curl_multi_remove_handle())
+        CURL* curl = msg->easy_handle;
+
+        if (msg->msg == CURLMSG_DONE && msg->data.result == CURLE_OK)
+        {
+            countconnection(curl);
+        }
+
+        curl_multi_remove_handle(curlm, curl);
+        curl_easy_cleanup(curl);
     }
 
     return done;
@@ -0,0 +1,103 @@
+/**
+ * @file posix/thread.cpp
+ * @brief POSIX threading primitives (using pthreads)
+ *
+ * (c) 2013-2014 by Mega Limited, Wellsford, New Zealand
+ *
+ * This file is part of the MEGA SDK - Client Access Engine.
+ *
+ * Applications using the MEGA API must present a valid application key
+ * and comply with the the rules set forth in the Terms of Service.
+ *
+ * The MEGA SDK is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @copyright Simplified (2-clause) BSD License.
+ *
+ * You should have received a copy of the license along with this
+ * program.
+ */
+
+#include "mega.h"
+
+namespace mega {
+void PosixThread::start(void* (*entry)(void*), void* arg)
+{
+    pthread_create(&thread, NULL, entry, arg);
+}
+
+void PosixThread::join()
+{
+    pthread_join(thread, NULL);
+}
+
+unsigned PosixThread::cores()
+{
+#ifdef _SC_NPROCESSORS_ONLN
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+
+    if (n > 0)
+    {
+        return (unsigned)n;
+    }
+#endif
+
+    return 1;
+}
+
+PosixMutex::PosixMutex()
+{
+    pthread_mutex_init(&mutex, NULL);
+}
+
+PosixMutex::~PosixMutex()
+{
+    pthread_mutex_destroy(&mutex);
+}
+
+void PosixMutex::lock()
+{
+    pthread_mutex_lock(&mutex);
+}
+
+void PosixMutex::unlock()
+{
+    pthread_mutex_unlock(&mutex);
+}
+
+PosixSemaphore::PosixSemaphore()
+{
+    count = 0;
+
+    pthread_mutex_init(&mutex, NULL);
+    pthread_cond_init(&cond, NULL);
+}
+
+PosixSemaphore::~PosixSemaphore()
+{
+    pthread_cond_destroy(&cond);
+    pthread_mutex_destroy(&mutex);
+}
+
+void PosixSemaphore::release()
+{
+    pthread_mutex_lock(&mutex);
+    count++;
+    pthread_cond_signal(&cond);
+    pthread_mutex_unlock(&mutex);
+}
+
+void PosixSemaphore::wait()
+{
+    pthread_mutex_lock(&mutex);
+
+    while (!count)
+    {
+        pthread_cond_wait(&cond, &mutex);
+    }
+
+    count--;
+    pthread_mutex_unlock(&mutex);
+}
+} // namespace
@@ -40,16 +40,59 @@ int clock_gettime(int, struct timespec* t)
 namespace mega {
 dstime Waiter::ds;
 
+PosixWaiter::PosixWaiter()
+{
+#ifdef USE_EPOLL
+    // (on failure, wait() falls back to poll())
+    epollfd = epoll_create(64);
+#endif
+
+    if (pipe(notifypipe) < 0)
+    {
+        notifypipe[0] = notifypipe[1] = -1;
+    }
+    else
+    {
+        fcntl(notifypipe[0], F_SETFL, fcntl(notifypipe[0], F_GETFL) | O_NONBLOCK);
+        fcntl(notifypipe[1], F_SETFL, fcntl(notifypipe[1], F_GETFL) | O_NONBLOCK);
+
+        watchfd(notifypipe[0], WAITREAD);
+    }
+}
+
+PosixWaiter::~PosixWaiter()
+{
+    if (notifypipe[0] >= 0)
+    {
+        close(notifypipe[0]);
+        close(notifypipe[1]);
+    }
+
+#ifdef USE_EPOLL
+    if (epollfd >= 0)
+    {
+        close(epollfd);
+    }
+#endif
+}
+
 void PosixWaiter::init(dstime ds)
 {
     Waiter::init(ds);
+}
 
-    maxfd = -1;
+// wake up from another thread (a full pipe already guarantees a wakeup)
+void PosixWaiter::notify()
+{
+    if (notifypipe[1] >= 0)
+    {
+        char c = 0;
 
-    FD_ZERO(&rfds);
-    FD_ZERO(&wfds);
-    FD_ZERO(&efds);
-    FD_ZERO(&ignorefds);
+        if (write(notifypipe[1], &c, 1) < 0)
+        {
+            return;
+        }
+    }
 }
 
 // update monotonously increasing timestamp in deciseconds
@@ -62,25 +105,66 @@ void Waiter::bumpds()
     ds = ts.tv_sec * 10 + ts.tv_nsec / 100000000;
 }
 
-// update maxfd for select()
-void PosixWaiter::bumpmaxfd(int fd)
+// add or update a persistent fd watch (unchanged watches are free)
+void PosixWaiter::watchfd(int fd, int events, bool ignored)
 {
-    if (fd > maxfd)
+    int flags = events | (ignored ? WAITIGNORE : 0);
+    map<int, int>::iterator it = watchedfds.find(fd);
+
+    if (it != watchedfds.end() && it->second == flags)
     {
-        maxfd = fd;
+        return;
     }
+
+#ifdef USE_EPOLL
+    if (epollfd >= 0)
+    {
+        epoll_event ev;
+
+        memset(&ev, 0, sizeof ev);
+
+        ev.events = ((events & WAITREAD) ? EPOLLIN : 0) | ((events & WAITWRITE) ? EPOLLOUT : 0);
+        ev.data.fd = fd;
+
+        if (epoll_ctl(epollfd, it == watchedfds.end() ? EPOLL_CTL_ADD : EPOLL_CTL_MOD, fd, &ev) < 0)
+        {
+            // (fd was closed and reused without being unwatched)
+            if (errno == ENOENT)
+            {
+                epoll_ctl(epollfd, EPOLL_CTL_ADD, fd, &ev);
+            }
+            else if (errno == EEXIST)
+            {
+                epoll_ctl(epollfd, EPOLL_CTL_MOD, fd, &ev);
+            }
+        }
+    }
+#endif
+
+    watchedfds[fd] = flags;
 }
 
-// checks if an unfiltered fd is set
-// FIXME: use bitwise & instead of scanning
-bool PosixWaiter::fd_filter(int nfds, fd_set* fds, fd_set* ignorefds) const
+void PosixWaiter::unwatchfd(int fd)
 {
-    while (nfds--)
+    if (watchedfds.erase(fd))
     {
-        if (FD_ISSET(nfds, fds) && !FD_ISSET(nfds, ignorefds)) return true;    
+#ifdef USE_EPOLL
+        // (fails harmlessly if fd is already closed)
+        if (epollfd >= 0)
+        {
+            epoll_ctl(epollfd, EPOLL_CTL_DEL, fd, NULL);
+        }
+#endif
     }
 
-    return false;
+    readyfds.erase(fd);
+}
+
+int PosixWaiter::fdevents(int fd) const
+{
+    map<int, int>::const_iterator it = readyfds.find(fd);
+
+    return it == readyfds.end() ? 0 : it->second;
 }
 
 // wait for supplied events (sockets, filesystem changes), plus timeout + application events
@@ -89,17 +173,66 @@ bool PosixWaiter::fd_filter(int nfds, fd_set* fds, fd_set* ignorefds) const
 int PosixWaiter::wait()
 {
     int numfd;
-    timeval tv;
+    int timeout = (maxds + 1) ? (int)(maxds * 100) : -1;
+
+    readyfds.clear();
 
-    if (maxds + 1)
+#ifdef USE_EPOLL
+    if (epollfd >= 0)
     {
-        dstime us = 1000000 / 10 * maxds;
+        epoll_event events[64];
+
+        numfd = epoll_wait(epollfd, events, sizeof events / sizeof *events, timeout);
+
+        for (int i = 0; i < numfd; i++)
+        {
+            int e = 0;
+
+            if (events[i].events & EPOLLIN)
+            {
+                e |= WAITREAD;
+            }
+
+            if (events[i].events & EPOLLOUT)
+            {
+                e |= WAITWRITE;
+            }
+
+            if (events[i].events & (EPOLLERR | EPOLLHUP))
+            {
+                e |= WAITERROR;
+            }
 
-        tv.tv_sec = us / 1000000;
-        tv.tv_usec = us - tv.tv_sec * 1000000;
+            readyfds[events[i].data.fd] = e;
+        }
     }
+    else
+#endif
+    {
+        // portable fallback (also used if epoll_create() failed): cost still
+        // scales with the number of watched fds
+        vector<pollfd> pfds(watchedfds.size());
+        unsigned n = 0;
 
-    numfd = select(maxfd + 1, &rfds, &wfds, &efds, maxds + 1 ? &tv : NULL);
+        for (map<int, int>::iterator it = watchedfds.begin(); it != watchedfds.end(); it++, n++)
+        {
+            pfds[n].fd = it->first;
+            pfds[n].events = ((it->second & WAITREAD) ? POLLIN : 0) | ((it->second & WAITWRITE) ? POLLOUT : 0);
+            pfds[n].revents = 0;
+        }
+
+        numfd = poll(n ? &pfds[0] : NULL, n, timeout);
+
+        for (unsigned i = 0; numfd > 0 && i < n; i++)
+        {
+            if (pfds[i].revents)
+            {
+                readyfds[pfds[i].fd] = ((pfds[i].revents & POLLIN) ? WAITREAD : 0)
+                                     | ((pfds[i].revents & POLLOUT) ? WAITWRITE : 0)
+                                     | ((pfds[i].revents & (POLLERR | POLLHUP | POLLNVAL)) ? WAITERROR : 0);
+            }
+        }
+    }
 
     // timeout or error
     if (numfd <= 0)
@@ -107,9 +240,25 @@ int PosixWaiter::wait()
         return NEEDEXEC;
     }
 
+    // drain pending notifications
+    if (notifypipe[0] >= 0 && fdevents(notifypipe[0]))
+    {
+        char buf[64];
+
+        while (read(notifypipe[0], buf, sizeof buf) > 0);
+    }
+
     // request exec() to be run only if a non-ignored fd was triggered
-    return (fd_filter(maxfd + 1, &rfds, &ignorefds)
-         || fd_filter(maxfd + 1, &wfds, &ignorefds)
-         || fd_filter(maxfd + 1, &efds, &ignorefds)) ? NEEDEXEC : 0;
+    for (map<int, int>::iterator it = readyfds.begin(); it != readyfds.end(); it++)
+    {
+        map<int, int>::iterator wit = watchedfds.find(it->first);
+
+        if (wit == watchedfds.end() || !(wit->second & WAITIGNORE))
+        {
+            return NEEDEXEC;
+        }
+    }
+
+    return 0;
 }
 } // namespace
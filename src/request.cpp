@@ -33,6 +33,32 @@ int Request::cmdspending() const
     return cmds.size();
 }
 
+// the first command's result can be processed before the response is complete
+bool Request::incremental() const
+{
+    return cmds.size() && cmds[0]->incremental;
+}
+
+void Request::procpartial(MegaClient* client, HttpReq* req)
+{
+    if (incremental())
+    {
+        client->restag = cmds[0]->tag;
+
+        cmds[0]->client = client;
+        cmds[0]->procpartial(req);
+    }
+}
+
+void Request::cancelpartial(MegaClient* client)
+{
+    if (incremental())
+    {
+        cmds[0]->client = client;
+        cmds[0]->cancelpartial();
+    }
+}
+
 void Request::get(string* req) const
 {
     // concatenate all command objects, resulting in an API request
@@ -43,7 +43,7 @@ void Share::serialize(string* d)
 bool Share::unserialize(MegaClient* client, int direction, handle h,
                         const byte* key, const char** ptr, const char* end)
 {
-    if (*ptr + sizeof(handle) + sizeof(m_time_t) + 2 > end)
+    if (*ptr + SERIALIZEDSIZE > end)
     {
         return 0;
     }
@@ -52,7 +52,7 @@ bool Share::unserialize(MegaClient* client, int direction, handle h,
                                              (accesslevel_t)(*ptr)[sizeof(handle) + sizeof(m_time_t)],
                                              MemAccess::get<m_time_t>(*ptr + sizeof(handle)), key));
 
-    *ptr += sizeof(handle) + sizeof(m_time_t) + 2;
+    *ptr += SERIALIZEDSIZE;
 
     return true;
 }
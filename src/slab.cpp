@@ -0,0 +1,139 @@
+/**
+ * @file slab.cpp
+ * @brief Fixed-size object allocator
+ *
+ * (c) 2013-2014 by Mega Limited, Wellsford, New Zealand
+ *
+ * This file is part of the MEGA SDK - Client Access Engine.
+ *
+ * Applications using the MEGA API must present a valid application key
+ * and comply with the the rules set forth in the Terms of Service.
+ *
+ * The MEGA SDK is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @copyright Simplified (2-clause) BSD License.
+ *
+ * You should have received a copy of the license along with this
+ * program.
+ */
+
+#include "mega/slab.h"
+
+namespace mega {
+SlabAllocator::SlabAllocator(size_t size, size_t perblock)
+{
+    objsize = (HEADERSIZE + size + HEADERSIZE - 1) & -HEADERSIZE;
+    blockobjs = perblock;
+
+    next = NULL;
+    blockend = NULL;
+    freelist = NULL;
+    live = 0;
+}
+
+SlabAllocator::~SlabAllocator()
+{
+    // (objects still live at this point are leaked with their blocks)
+    for (unsigned i = blocks.size(); i--; )
+    {
+        delete[] blocks[i];
+    }
+}
+
+void* SlabAllocator::alloc(size_t size)
+{
+    char* ptr;
+
+    if (HEADERSIZE + size > objsize)
+    {
+        return heapalloc(size);
+    }
+
+    if (freelist)
+    {
+        ptr = (char*)freelist;
+        freelist = *(void**)freelist;
+    }
+    else
+    {
+        if (next == blockend)
+        {
+            next = new char[objsize * blockobjs];
+            blockend = next + objsize * blockobjs;
+            blocks.push_back(next);
+        }
+
+        ptr = next;
+        next += objsize;
+    }
+
+    live++;
+
+    *(SlabAllocator**)ptr = this;
+
+    return ptr + HEADERSIZE;
+}
+
+void* SlabAllocator::heapalloc(size_t size)
+{
+    char* ptr = new char[HEADERSIZE + size];
+
+    *(SlabAllocator**)ptr = NULL;
+
+    return ptr + HEADERSIZE;
+}
+
+void SlabAllocator::release(void* p)
+{
+    if (!p)
+    {
+        return;
+    }
+
+    char* ptr = (char*)p - HEADERSIZE;
+    SlabAllocator* slab = *(SlabAllocator**)ptr;
+
+    if (!slab)
+    {
+        delete[] ptr;
+        return;
+    }
+
+    *(void**)ptr = slab->freelist;
+    slab->freelist = ptr;
+    slab->live--;
+}
+
+bool SlabAllocator::purge()
+{
+    if (live)
+    {
+        return false;
+    }
+
+    for (unsigned i = blocks.size(); i--; )
+    {
+        delete[] blocks[i];
+    }
+
+    blocks.clear();
+
+    next = NULL;
+    blockend = NULL;
+    freelist = NULL;
+
+    return true;
+}
+
+size_t SlabAllocator::inuse() const
+{
+    return live;
+}
+
+size_t SlabAllocator::footprint() const
+{
+    return blocks.size() * objsize * blockobjs;
+}
+} // namespace
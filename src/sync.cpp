@@ -45,6 +45,15 @@ Sync::Sync(MegaClient* cclient, string* crootpath, const char* cdebris,
     state = SYNC_INITIALSCAN;
 
     fullscan = true;
+
+    cacheflushpending = false;
+    cacheflushes = 0;
+    cacheflushrecords = 0;
+    cacheflushds = 0;
+    cacheflushmaxds = 0;
+
+    fingerprinthits = 0;
+    fingerprintmisses = 0;
 	
     if (cdebris)
     {
@@ -101,6 +110,8 @@ Sync::~Sync()
     // runs
     assert(state == SYNC_CANCELED);
 
+    stopprefetch();
+
     // unlock tmp lock
     delete tmpfa;
 
@@ -224,8 +235,18 @@ void Sync::statecacheadd(LocalNode* l)
 
 void Sync::cachenodes()
 {
+    cacheflushpending = false;
+
     if (statecachetable && state == SYNC_ACTIVE && (deleteq.size() || insertq.size()))
     {
+        Waiter::bumpds();
+
+        dstime startds = Waiter::ds;
+        unsigned added = 0;
+        unsigned nextcheck = 256;
+        unsigned stuck = 0;
+        vector<LocalNode*> chain;
+
         statecachetable->begin();
 
         // deletions
@@ -236,27 +257,108 @@ void Sync::cachenodes()
 
         deleteq.clear();
 
-        // additions - we iterate until completion or until we get stuck 
-        bool added;
-        
-        do {
-            added = false;
+        // additions - a node's record refers to its parent's, so queued
+        // ancestors are written first (nodes whose parent is neither cached
+        // nor queued are stuck and remain queued)
+        localnode_set::iterator it = insertq.begin();
+
+        while (it != insertq.end())
+        {
+            if (added >= CACHEFLUSHBATCH)
+            {
+                cacheflushpending = true;
+                break;
+            }
+
+            LocalNode* l = *it;
+
+            chain.clear();
+
+            for (;;)
+            {
+                chain.push_back(l);
+
+                if (l->parent == &localroot || l->parent->dbid)
+                {
+                    break;
+                }
+
+                if (!insertq.count(l->parent))
+                {
+                    chain.clear();
+                    break;
+                }
+
+                l = l->parent;
+            }
+
+            if (!chain.size())
+            {
+                stuck++;
+                it++;
+                continue;
+            }
+
+            l = *it;
+
+            while (chain.size())
+            {
+                statecachetable->put(MegaClient::CACHEDLOCALNODE, chain.back(), &client->key);
+                insertq.erase(chain.back());
+                chain.pop_back();
+                added++;
+            }
 
-            for (set<LocalNode*>::iterator it = insertq.begin(); it != insertq.end(); )
+            it = insertq.upper_bound(l);
+
+            // check the time budget every now and then
+            if (added >= nextcheck)
             {
-                if ((*it)->parent->dbid || (*it)->parent == &localroot)
+                nextcheck = added + 256;
+
+                Waiter::bumpds();
+
+                if (Waiter::ds - startds >= CACHEFLUSHDS)
                 {
-                    statecachetable->put(MegaClient::CACHEDLOCALNODE, *it, &client->key);
-                    insertq.erase(it++);
-                    added = true;
+                    cacheflushpending = it != insertq.end();
+                    break;
                 }
-                else it++;
             }
-        } while (added);
+        }
 
         statecachetable->commit();
 
-        if (insertq.size()) client->app->debug_log("LocalNode caching did not complete");
+        Waiter::bumpds();
+
+        dstime elapsed = Waiter::ds - startds;
+
+        cacheflushes++;
+        cacheflushrecords += added;
+        cacheflushds += elapsed;
+
+        if (elapsed > cacheflushmaxds)
+        {
+            cacheflushmaxds = elapsed;
+        }
+
+        if (elapsed >= CACHEFLUSHDS)
+        {
+            char buf[128];
+
+            sprintf(buf, "LocalNode cache flush: %u records in %u ds (%u pending)",
+                    added, (unsigned)elapsed, (unsigned)insertq.size());
+            client->app->debug_log(buf);
+        }
+
+        if (cacheflushpending)
+        {
+            // resume in the next exec() iteration without waiting
+            client->syncactivity = true;
+        }
+        else if (stuck)
+        {
+            client->app->debug_log("LocalNode caching did not complete");
+        }
     }
 }
 
@@ -359,14 +461,19 @@ LocalNode* Sync::localnodebypath(LocalNode* l, string* localpath, LocalNode** pa
 
 // scan localpath, add or update child nodes, call recursively for folder nodes
 // localpath must be prefixed with Sync
+bool Sync::indebris(string* localpath)
+{
+    return localpath->size() >= localdebris.size()
+        && !memcmp(localpath->data(), localdebris.data(), localdebris.size())
+        && (localpath->size() == localdebris.size()
+            || !memcmp(localpath->data() + localdebris.size(),
+                       client->fsaccess->localseparator.data(),
+                       client->fsaccess->localseparator.size()));
+}
+
 bool Sync::scan(string* localpath, FileAccess* fa)
 {
-	if (localpath->size() < localdebris.size()
-		|| memcmp(localpath->data(), localdebris.data(), localdebris.size())
-		|| (localpath->size() != localdebris.size()
-			&& memcmp(localpath->data() + localdebris.size(),
-					  client->fsaccess->localseparator.data(),
-					  client->fsaccess->localseparator.size())))
+	if (!indebris(localpath))
 	{
 		DirAccess* da;
 		string localname, name;
@@ -395,12 +502,7 @@ bool Sync::scan(string* localpath, FileAccess* fa)
 					localpath->append(localname);
 
 					// skip the sync's debris folder
-					if ((localpath->size() < localdebris.size())
-						|| memcmp(localpath->data(), localdebris.data(), localdebris.size())
-						|| ((localpath->size() != localdebris.size())
-							&& memcmp(localpath->data() + localdebris.size(),
-									  client->fsaccess->localseparator.data(),
-									  client->fsaccess->localseparator.size())))
+					if (!indebris(localpath))
 					{
 						// new or existing record: place scan result in notification queue
 						dirnotify->notify(DirNotify::DIREVENTS, NULL, localpath->data(), localpath->size(), true);
@@ -430,6 +532,8 @@ LocalNode* Sync::checkpath(LocalNode* l, string* localpath, string* localname)
     FileAccess* fa;
     bool newnode = false, changed = false;
     bool isroot;
+    FileFingerprint prefetchedfp;
+    FileFingerprint* fp = NULL;
 
     LocalNode* parent;
     string path;        // UTF-8 representation of tmppath
@@ -499,6 +603,20 @@ LocalNode* Sync::checkpath(LocalNode* l, string* localpath, string* localname)
 
     if (fa->fopen(localname ? localpath : &tmppath, true, false))
     {
+        // claim the parallel scan stage's fingerprint (also if it turns out
+        // not to be needed, so that it does not linger)
+        if (fa->fsidvalid && prefetched.size())
+        {
+            handlefingerprint_map::iterator it = prefetched.find(fa->fsid);
+
+            if (it != prefetched.end())
+            {
+                prefetchedfp = it->second;
+                fp = &prefetchedfp;
+                prefetched.erase(it);
+            }
+        }
+
         // match cached LocalNode state during initial/rescan to prevent costly re-fingerprinting
         // (just compare the fsids, sizes and mtimes to detect changes)
         if (fullscan)
@@ -594,7 +712,7 @@ LocalNode* Sync::checkpath(LocalNode* l, string* localpath, string* localname)
 
                         m_off_t dsize = l->size;
 
-                        if (l->genfingerprint(fa))
+                        if (genfingerprint(l, fa, fp))
                         {
                             localbytes -= dsize - l->size;
                         }
@@ -655,7 +773,7 @@ LocalNode* Sync::checkpath(LocalNode* l, string* localpath, string* localname)
                 else
                 {
                     // this is a new node: add
-                    l = new LocalNode;
+                    l = new(client) LocalNode;
                     l->init(this, fa->type, parent, localname ? localpath : &tmppath);
 
                     if (fa->fsidvalid)
@@ -702,7 +820,7 @@ LocalNode* Sync::checkpath(LocalNode* l, string* localpath, string* localname)
                         localbytes -= l->size;
                     }
 
-                    if (l->genfingerprint(fa))
+                    if (genfingerprint(l, fa, fp))
                     {
                         changed = true;
                         l->bumpnagleds();
@@ -767,6 +885,260 @@ LocalNode* Sync::checkpath(LocalNode* l, string* localpath, string* localname)
     return l;
 }
 
+bool Sync::genfingerprint(LocalNode* l, FileAccess* fa, FileFingerprint* fp)
+{
+    handlelocalnode_map::iterator it;
+
+    // gathered by the parallel scan stage?
+    if (fp && fp->size == fa->size && fp->mtime == fa->mtime)
+    {
+        bool changed = !l->isvalid || l->size != fp->size || l->mtime != fp->mtime
+                    || memcmp(l->crc, fp->crc, sizeof l->crc);
+
+        *(FileFingerprint*)l = *fp;
+
+        fingerprinthits++;
+        return changed;
+    }
+
+    if (fa->fsidvalid && (it = client->fsidnode.find(fa->fsid)) != client->fsidnode.end())
+    {
+        LocalNode* cl = it->second;
+
+        if (cl->sync == this && cl->type == FILENODE && cl->isvalid
+         && cl->size == fa->size && cl->mtime == fa->mtime)
+        {
+            bool changed = !l->isvalid || l->size != cl->size || l->mtime != cl->mtime
+                        || memcmp(l->crc, cl->crc, sizeof l->crc);
+
+            if (cl != l)
+            {
+                *(FileFingerprint*)l = *(FileFingerprint*)cl;
+            }
+
+            fingerprinthits++;
+            return changed;
+        }
+    }
+
+    fingerprintmisses++;
+    return l->genfingerprint(fa);
+}
+
+bool Sync::knownfile(handle fsid, m_off_t size, m_time_t mtime)
+{
+    handlelocalnode_map::iterator it = client->fsidnode.find(fsid);
+
+    if (it == client->fsidnode.end())
+    {
+        return false;
+    }
+
+    LocalNode* l = it->second;
+
+    return l->sync == this && l->type == FILENODE && l->isvalid && l->size == size && l->mtime == mtime;
+}
+
+// begin the parallel scan of the sync's tree (restarts a scan in progress)
+void Sync::startprefetch()
+{
+    stopprefetch();
+
+    if (client->workers->numthreads() > 1)
+    {
+        prefetchq.push_back(new ScanJob(this, &localroot.localname));
+        pumpprefetch();
+    }
+}
+
+// cancel the parallel scan and discard unconsumed results
+void Sync::stopprefetch()
+{
+    // (running jobs stop after the current file rather than completing their
+    // folder while cancel() waits for them)
+    for (set<ScanJob*>::iterator it = prefetchjobs.begin(); it != prefetchjobs.end(); it++)
+    {
+        (*it)->aborted = true;
+    }
+
+    while (prefetchjobs.size())
+    {
+        ScanJob* job = *prefetchjobs.begin();
+
+        prefetchjobs.erase(prefetchjobs.begin());
+        client->workers->cancel(job);
+    }
+
+    for (deque<ScanJob*>::iterator it = prefetchq.begin(); it != prefetchq.end(); it++)
+    {
+        delete *it;
+    }
+
+    prefetchq.clear();
+    prefetched.clear();
+}
+
+// keep the workers busy, unless checkpath() is too far behind
+void Sync::pumpprefetch()
+{
+    while (prefetchq.size()
+           && prefetchjobs.size() + 1 < client->workers->numthreads()
+           && prefetched.size() < MAXPREFETCHED)
+    {
+        ScanJob* job = prefetchq.front();
+
+        prefetchq.pop_front();
+        prefetchjobs.insert(job);
+        client->workers->push(job);
+    }
+}
+
+ScanJob::ScanJob(Sync* s, string* path, vector<string>* n)
+{
+    sync = s;
+    fsaccess = s->client->fsaccess;
+    localpath = *path;
+    aborted = false;
+
+    if (n)
+    {
+        names.swap(*n);
+    }
+}
+
+// (worker thread)
+void ScanJob::run()
+{
+    string path;
+    FileAccess* fa;
+
+    if (names.size())
+    {
+        for (unsigned i = 0; i < names.size() && !aborted; i++)
+        {
+            path = localpath;
+            path.append(fsaccess->localseparator);
+            path.append(names[i]);
+
+            fa = fsaccess->newfileaccess();
+
+            if (fa->fopen(&path, true, false) && fa->type == FILENODE && fa->fsidvalid)
+            {
+                FileFingerprint* fp = &files[fa->fsid];
+
+                fp->genfingerprint(fa);
+
+                if (!fp->isvalid)
+                {
+                    files.erase(fa->fsid);
+                }
+            }
+
+            delete fa;
+        }
+
+        return;
+    }
+
+    DirAccess* da = fsaccess->newdiraccess();
+    string localname;
+    nodetype_t type;
+
+    if (da->dopen(&localpath, NULL, false))
+    {
+        while (!aborted && da->dnext(&localname, &type))
+        {
+            if (type == FOLDERNODE)
+            {
+                folders.push_back(localname);
+                continue;
+            }
+
+            path = localpath;
+            path.append(fsaccess->localseparator);
+            path.append(localname);
+
+            fa = fsaccess->newfileaccess();
+
+            if (fa->fopen(&path, true, false) && fa->type == FILENODE && fa->fsidvalid)
+            {
+                entries.resize(entries.size() + 1);
+
+                Entry* e = &entries.back();
+
+                e->name = localname;
+                e->fsid = fa->fsid;
+                e->size = fa->size;
+                e->mtime = fa->mtime;
+            }
+
+            delete fa;
+        }
+    }
+
+    delete da;
+}
+
+// hand fingerprints to the sync, have the syncable new or changed files
+// fingerprinted and queue the syncable subfolders
+void ScanJob::complete(MegaClient* client)
+{
+    string path, name;
+    vector<string> selected;
+
+    sync->prefetchjobs.erase(this);
+
+    for (handlefingerprint_map::iterator it = files.begin(); it != files.end(); it++)
+    {
+        // (unless checkpath() got there first)
+        if (!sync->knownfile(it->first, it->second.size, it->second.mtime))
+        {
+            sync->prefetched[it->first] = it->second;
+        }
+    }
+
+    for (unsigned i = 0; i < entries.size(); i++)
+    {
+        if (!sync->knownfile(entries[i].fsid, entries[i].size, entries[i].mtime))
+        {
+            name = entries[i].name;
+            client->fsaccess->local2name(&name);
+
+            if (client->app->sync_syncable(name.c_str(), &localpath, &entries[i].name))
+            {
+                selected.push_back(entries[i].name);
+            }
+        }
+    }
+
+    if (selected.size())
+    {
+        sync->prefetchq.push_front(new ScanJob(sync, &localpath, &selected));
+    }
+
+    for (unsigned i = 0; i < folders.size(); i++)
+    {
+        name = folders[i];
+        client->fsaccess->local2name(&name);
+
+        if (client->app->sync_syncable(name.c_str(), &localpath, &folders[i]))
+        {
+            path = localpath;
+            path.append(client->fsaccess->localseparator);
+            path.append(folders[i]);
+
+            if (!sync->indebris(&path))
+            {
+                sync->prefetchq.push_back(new ScanJob(sync, &path));
+            }
+        }
+    }
+
+    sync->pumpprefetch();
+
+    delete this;
+}
+
 // add or refresh local filesystem item from scan stack, add items to scan stack
 // returns 0 if a parent node is missing, ~0 if control should be yielded, or the time
 // until a retry should be made (300 ms minimum latency).
@@ -774,10 +1146,13 @@ dstime Sync::procscanq(int q)
 {
     size_t t = dirnotify->notifyq[q].size();
     dstime dsmin = Waiter::ds - 3;
+    dstime startds = Waiter::ds;
     LocalNode* l;
 
     while (t--)
     {
+        unsigned misses = fingerprintmisses;
+
         if (dirnotify->notifyq[q].front().timestamp > dsmin)
         {
             return dirnotify->notifyq[q].front().timestamp - dsmin;
@@ -793,15 +1168,25 @@ dstime Sync::procscanq(int q)
 
         dirnotify->notifyq[q].pop_front();
 
-        // we return control to the application in case a filenode was added
-        // (in order to avoid lengthy blocking episodes due to multiple
-        // consecutive fingerprint calculations)
-        if (l && (l->type == FILENODE))
+        // we return control to the application in case a file had to be
+        // fingerprinted (in order to avoid lengthy blocking episodes due to
+        // multiple consecutive fingerprint calculations) or the time slice
+        // is used up
+        if (l && (l->type == FILENODE) && fingerprintmisses != misses)
+        {
+            break;
+        }
+
+        Waiter::bumpds();
+
+        if (Waiter::ds - startds >= SCANYIELDDS)
         {
             break;
         }
     }
 
+    pumpprefetch();
+
     if (dirnotify->notifyq[q].size())
     {
         if (q == DirNotify::DIREVENTS)
@@ -116,7 +116,6 @@ void Transfer::complete()
 
         int missingattr = 0;
         handle attachh;
-        SymmCipher* key;
 
         // set FileFingerprint on source node(s) if missing
         for (file_list::iterator it = files.begin(); it != files.end(); it++)
@@ -129,7 +128,6 @@ void Transfer::complete()
                     if (!n->hasfileattribute(GfxProc::THUMBNAIL120X120)) missingattr |= 1 << GfxProc::THUMBNAIL120X120;
                     if (!n->hasfileattribute(GfxProc::PREVIEW1000x1000)) missingattr |= 1 << GfxProc::PREVIEW1000x1000;
                     attachh = n->nodehandle;
-                    key = &n->key;
                 }
         
                 if (!n->isvalid)
@@ -142,10 +140,11 @@ void Transfer::complete()
             }
         }
 
-        if (missingattr)
+        // (the node cipher is only valid until the next node's is expanded)
+        if (missingattr && (n = client->nodebyhandle(attachh)) && n->nodecipher())
         {
             // FIXME: do this while file is still open
-            client->gfx->gendimensionsputfa(NULL, &localfilename, attachh, key, missingattr);
+            client->gfx->gendimensionsputfa(NULL, &localfilename, attachh, n->nodecipher(), missingattr);
         }
 
         // ...and place it in all target locations. first, update the files'
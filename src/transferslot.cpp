@@ -27,8 +27,62 @@
 #include "mega/base64.h"
 #include "mega/megaapp.h"
 #include "mega/utils.h"
+#include "megathread.h"
 
 namespace mega {
+TransferChunkJob::TransferChunkJob(TransferSlot* cslot, HttpReqXfer* creq, m_off_t cpos, m_off_t cnpos)
+    : key(cslot->transfer->key.key)
+{
+    slot = cslot;
+    req = creq;
+    ctriv = slot->transfer->ctriv;
+    pos = cpos;
+    npos = cnpos;
+    success = false;
+    done = false;
+
+    req->size = (unsigned)(npos - pos);
+}
+
+// worker thread: only the file I/O is serialized
+void TransferChunkJob::run()
+{
+    if (req->buf)
+    {
+        // downloaded chunk: decrypt, MAC and write
+        HttpReqXfer::chunkcrypt(&key, req->buf, req->bufpos, pos, ctriv, &macs, 0);
+
+        slot->famutex->lock();
+        slot->fa->fwrite(req->buf, req->bufpos, pos);
+        slot->famutex->unlock();
+
+        success = true;
+    }
+    else
+    {
+        // chunk to upload: read, MAC and encrypt
+        slot->famutex->lock();
+        success = slot->fa->fread(req->out, req->size, (-(int)req->size) & (SymmCipher::BLOCKSIZE - 1), pos);
+        slot->famutex->unlock();
+
+        if (success)
+        {
+            HttpReqXfer::chunkcrypt(&key, (byte*)req->out->data(), req->size, pos, ctriv, &macs, 1);
+        }
+    }
+}
+
+// results are picked up by TransferSlot::doio()
+void TransferChunkJob::complete(MegaClient*)
+{
+    done = true;
+
+    if (!success)
+    {
+        retrybt.backoff(2);
+    }
+}
+
 TransferSlot::TransferSlot(Transfer* ctransfer)
 {
     starttime = 0;
@@ -51,6 +105,15 @@ TransferSlot::TransferSlot(Transfer* ctransfer)
     connections = transfer->size > 131072 ? transfer->client->connections[transfer->type] : 1;
 
     reqs = new HttpReqXfer*[connections]();
+    jobs = new TransferChunkJob*[connections]();
+
+    reqsize = 0;
+    reqspeed = 0;
+    reqlatency = 0;
+    reqstarted = new dstime[connections]();
+    reqfirstdata = new dstime[connections]();
+
+    famutex = new MUTEX_CLASS;
 
     fa = transfer->client->fsaccess->newfileaccess();
 
@@ -79,6 +142,27 @@ TransferSlot::~TransferSlot()
         pendingcmd->cancel();
     }
 
+    // jobs may still be accessing fa and reqs
+    for (int i = connections; i--; )
+    {
+        if (jobs[i])
+        {
+            if (jobs[i]->done)
+            {
+                delete jobs[i];
+            }
+            else
+            {
+                transfer->client->workers->cancel(jobs[i]);
+            }
+        }
+    }
+
+    delete[] jobs;
+    delete[] reqstarted;
+    delete[] reqfirstdata;
+    delete famutex;
+
     if (fa)
     {
         delete fa;
@@ -109,6 +193,72 @@ void TransferSlot::disconnect()
     }
 }
 
+// number of chunks being processed by worker threads
+int TransferSlot::asyncjobs() const
+{
+    int n = 0;
+
+    for (int i = connections; i--; )
+    {
+        if (jobs[i])
+        {
+            n++;
+        }
+    }
+
+    return n;
+}
+
+// end of the next request: the next chunk boundary, extended by further
+// complete chunks while they fit into the current request size
+m_off_t TransferSlot::nextreqpos(m_off_t pos)
+{
+    m_off_t npos = ChunkedHash::chunkceil(pos);
+
+    while (npos < transfer->size)
+    {
+        m_off_t nnpos = ChunkedHash::chunkceil(npos);
+
+        if (nnpos - pos > reqsize)
+        {
+            break;
+        }
+
+        npos = nnpos;
+    }
+
+    return npos;
+}
+
+// size subsequent requests so that the per-request latency (connection setup
+// and server round trip) amortizes to about 1/REQLATENCYFACTOR
+void TransferSlot::updatereqsize(int i)
+{
+    if (!reqstarted[i] || !reqfirstdata[i])
+    {
+        return;
+    }
+
+    dstime latency = reqfirstdata[i] - reqstarted[i];
+    dstime duration = Waiter::ds - reqfirstdata[i];
+    m_off_t speed = reqs[i]->size / (duration ? duration : 1);
+
+    // exponential smoothing (1/4 weight for the new sample)
+    reqlatency = reqlatency ? (3 * reqlatency + latency) / 4 : latency;
+    reqspeed = reqspeed ? (3 * reqspeed + speed) / 4 : speed;
+
+    // (ds resolution: sub-100 ms latencies are treated as 100 ms)
+    reqsize = reqspeed * REQLATENCYFACTOR * (reqlatency ? reqlatency : 1);
+
+    if (reqsize > MAXREQSIZE)
+    {
+        reqsize = MAXREQSIZE;
+    }
+
+    reqstarted[i] = 0;
+    reqfirstdata[i] = 0;
+}
+
 // coalesce block macs into file mac
 int64_t TransferSlot::macsmac(chunkmac_map* macs)
 {
@@ -159,12 +309,23 @@ void TransferSlot::doio(MegaClient* client)
             switch (reqs[i]->status)
             {
                 case REQ_INFLIGHT:
-                    p += reqs[i]->transferred(client);
+                    {
+                        m_off_t t = reqs[i]->transferred(client);
+
+                        if (t && !reqfirstdata[i])
+                        {
+                            reqfirstdata[i] = Waiter::ds;
+                        }
+
+                        p += t;
+                    }
                     break;
 
                 case REQ_SUCCESS:
                     lastdata = Waiter::ds;
 
+                    updatereqsize(i);
+
                     progresscompleted += reqs[i]->size;
 
                     if (transfer->type == PUT)
@@ -199,6 +360,17 @@ void TransferSlot::doio(MegaClient* client)
                         {
                             errorcount = 0;
 
+                            if (client->workers->numthreads())
+                            {
+                                // decrypt, MAC and write on a worker thread
+                                HttpReqDL* req = (HttpReqDL*)reqs[i];
+
+                                jobs[i] = new TransferChunkJob(this, req, req->dlpos, req->dlpos + req->size);
+                                req->status = REQ_ASYNCIO;
+                                client->workers->push(jobs[i]);
+                                break;
+                            }
+
                             reqs[i]->finalize(fa, &transfer->key, &transfer->chunkmacs, transfer->ctriv, 0, -1);
 
                             if (progresscompleted == transfer->size)
@@ -225,6 +397,74 @@ void TransferSlot::doio(MegaClient* client)
                     reqs[i]->status = REQ_READY;
                     break;
 
+                case REQ_ASYNCIO:
+                    if (!jobs[i]->done)
+                    {
+                        break;
+                    }
+
+                    if (!jobs[i]->success)
+                    {
+                        if (!fa->retry)
+                        {
+                            return transfer->failed(API_EREAD);
+                        }
+
+                        // retry the read shortly
+                        if (jobs[i]->retrybt.armed())
+                        {
+                            jobs[i]->done = false;
+                            client->workers->push(jobs[i]);
+                        }
+                        else
+                        {
+                            backoff = 2;
+                        }
+
+                        break;
+                    }
+
+                    // chunk MACs are keyed by position, so the meta MAC does
+                    // not depend on the order of job completion
+                    for (chunkmac_map::iterator it = jobs[i]->macs.begin(); it != jobs[i]->macs.end(); it++)
+                    {
+                        transfer->chunkmacs[it->first] = it->second;
+                    }
+
+                    if (transfer->type == PUT)
+                    {
+                        char buf[256];
+
+                        snprintf(buf, sizeof buf, "%s/%" PRIu64, tempurl.c_str(), jobs[i]->pos);
+                        reqs[i]->setreq(buf, REQ_BINARY);
+
+                        // unpad for POSTing
+                        reqs[i]->out->resize(reqs[i]->size);
+
+                        reqs[i]->status = REQ_PREPARED;
+                    }
+                    else
+                    {
+                        reqs[i]->status = REQ_READY;
+                    }
+
+                    delete jobs[i];
+                    jobs[i] = NULL;
+
+                    if (transfer->type == GET && progresscompleted == transfer->size && !asyncjobs())
+                    {
+                        // verify meta MAC
+                        if (!progresscompleted || (macsmac(&transfer->chunkmacs) == transfer->metamac))
+                        {
+                            return transfer->complete();
+                        }
+                        else
+                        {
+                            return transfer->failed(API_EKEY);
+                        }
+                    }
+                    break;
+
                 case REQ_FAILURE:
                     if (reqs[i]->httpstatus == 509)
                     {
@@ -253,7 +493,7 @@ void TransferSlot::doio(MegaClient* client)
         {
             if (!reqs[i] || (reqs[i]->status == REQ_READY))
             {
-                m_off_t npos = ChunkedHash::chunkceil(transfer->pos);
+                m_off_t npos = nextreqpos(transfer->pos);
 
                 if (npos > transfer->size)
                 {
@@ -267,9 +507,17 @@ void TransferSlot::doio(MegaClient* client)
                         reqs[i] = transfer->type == PUT ? (HttpReqXfer*)new HttpReqUL() : (HttpReqXfer*)new HttpReqDL();
                     }
 
-                    if (reqs[i]->prepare(fa, tempurl.c_str(), &transfer->key,
-                                         &transfer->chunkmacs, transfer->ctriv,
-                                         transfer->pos, npos))
+                    if (transfer->type == PUT && client->workers->numthreads())
+                    {
+                        // read, MAC and encrypt on a worker thread
+                        jobs[i] = new TransferChunkJob(this, reqs[i], transfer->pos, npos);
+                        reqs[i]->status = REQ_ASYNCIO;
+                        transfer->pos = npos;
+                        client->workers->push(jobs[i]);
+                    }
+                    else if (reqs[i]->prepare(fa, tempurl.c_str(), &transfer->key,
+                                              &transfer->chunkmacs, transfer->ctriv,
+                                              transfer->pos, npos))
                     {
                         reqs[i]->status = REQ_PREPARED;
                         transfer->pos = npos;
@@ -294,6 +542,9 @@ void TransferSlot::doio(MegaClient* client)
             if (reqs[i] && (reqs[i]->status == REQ_PREPARED))
             {
                 reqs[i]->post(client);
+
+                reqstarted[i] = Waiter::ds;
+                reqfirstdata[i] = 0;
             }
         }
     }
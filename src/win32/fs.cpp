@@ -26,12 +26,24 @@ WinFileAccess::WinFileAccess()
 {
     hFile = INVALID_HANDLE_VALUE;
     hFind = INVALID_HANDLE_VALUE;
+    hMapping = NULL;
+    mapped = NULL;
 
     fsidvalid = false;
 }
 
 WinFileAccess::~WinFileAccess()
 {
+    if (mapped)
+    {
+        UnmapViewOfFile(mapped);
+    }
+
+    if (hMapping)
+    {
+        CloseHandle(hMapping);
+    }
+
     if (hFile != INVALID_HANDLE_VALUE)
     {
         CloseHandle(hFile);
@@ -66,6 +78,24 @@ bool WinFileAccess::fwrite(const byte* data, unsigned len, m_off_t pos)
     return WriteFile(hFile, (LPCVOID)data, (DWORD)len, &dwWritten, NULL) && dwWritten == len;
 }
 
+const byte* WinFileAccess::fmap()
+{
+    if (!mapped && hFile != INVALID_HANDLE_VALUE && size > 0 && (SIZE_T)size == size)
+    {
+        if (!hMapping)
+        {
+            hMapping = CreateFileMappingW(hFile, NULL, PAGE_READONLY, 0, 0, NULL);
+        }
+
+        if (hMapping)
+        {
+            mapped = (const byte*)MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, 0);
+        }
+    }
+
+    return mapped;
+}
+
 m_time_t FileTime_to_POSIX(FILETIME* ft)
 {
     LARGE_INTEGER date;
@@ -195,10 +225,10 @@ bool WinFileAccess::fopen(string* name, bool read, bool write)
     // (race condition between GetFileAttributesEx()/FindFirstFile() possible -
     // fixable with the current Win32 API?)
     hFile = CreateFileW((LPCWSTR)name->data(),
-                        read ? GENERIC_READ : GENERIC_WRITE,
+                        read ? (write ? GENERIC_READ | GENERIC_WRITE : GENERIC_READ) : GENERIC_WRITE,
                         FILE_SHARE_WRITE | FILE_SHARE_READ,
                         NULL,
-                        read ? OPEN_EXISTING : OPEN_ALWAYS,
+                        write ? OPEN_ALWAYS : OPEN_EXISTING,
                         ((type == FOLDERNODE) ? FILE_FLAG_BACKUP_SEMANTICS : 0),
                         NULL);
 
@@ -240,7 +270,21 @@ bool WinFileAccess::fopen(string* name, bool read, bool write)
 
     if (read)
     {
-        size = ((m_off_t)fad.nFileSizeHigh << 32) + (m_off_t)fad.nFileSizeLow;
+        if (write)
+        {
+            LARGE_INTEGER li;
+
+            if (!GetFileSizeEx(hFile, &li))
+            {
+                return false;
+            }
+
+            size = li.QuadPart;
+        }
+        else
+        {
+            size = ((m_off_t)fad.nFileSizeHigh << 32) + (m_off_t)fad.nFileSizeLow;
+        }
     }
 
     return true;
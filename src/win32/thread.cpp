@@ -0,0 +1,108 @@
+/**
+ * @file win32/thread.cpp
+ * @brief Win32 threading primitives
+ *
+ * (c) 2013-2014 by Mega Limited, Wellsford, New Zealand
+ *
+ * This file is part of the MEGA SDK - Client Access Engine.
+ *
+ * Applications using the MEGA API must present a valid application key
+ * and comply with the the rules set forth in the Terms of Service.
+ *
+ * The MEGA SDK is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @copyright Simplified (2-clause) BSD License.
+ *
+ * You should have received a copy of the license along with this
+ * program.
+ */
+
+#include "mega.h"
+
+namespace mega {
+WinThread::WinThread()
+{
+    hThread = NULL;
+}
+
+WinThread::~WinThread()
+{
+    if (hThread)
+    {
+        CloseHandle(hThread);
+    }
+}
+
+DWORD WINAPI WinThread::run(LPVOID lpParameter)
+{
+    WinThread* t = (WinThread*)lpParameter;
+
+    t->entry(t->arg);
+
+    return 0;
+}
+
+void WinThread::start(void* (*centry)(void*), void* carg)
+{
+    entry = centry;
+    arg = carg;
+
+    hThread = CreateThread(NULL, 0, run, this, 0, NULL);
+}
+
+void WinThread::join()
+{
+    WaitForSingleObject(hThread, INFINITE);
+}
+
+unsigned WinThread::cores()
+{
+    SYSTEM_INFO si;
+
+    GetSystemInfo(&si);
+
+    return si.dwNumberOfProcessors ? si.dwNumberOfProcessors : 1;
+}
+
+WinMutex::WinMutex()
+{
+    InitializeCriticalSection(&cs);
+}
+
+WinMutex::~WinMutex()
+{
+    DeleteCriticalSection(&cs);
+}
+
+void WinMutex::lock()
+{
+    EnterCriticalSection(&cs);
+}
+
+void WinMutex::unlock()
+{
+    LeaveCriticalSection(&cs);
+}
+
+WinSemaphore::WinSemaphore()
+{
+    hSemaphore = CreateSemaphore(NULL, 0, LONG_MAX, NULL);
+}
+
+WinSemaphore::~WinSemaphore()
+{
+    CloseHandle(hSemaphore);
+}
+
+void WinSemaphore::release()
+{
+    ReleaseSemaphore(hSemaphore, 1, NULL);
+}
+
+void WinSemaphore::wait()
+{
+    WaitForSingleObject(hSemaphore, INFINITE);
+}
+} // namespace
@@ -40,6 +40,19 @@ WinWaiter::WinWaiter()
         tickhigh = 0;
         prevt = 0;
     }
+
+    hNotify = CreateEvent(NULL, FALSE, FALSE, NULL);
+}
+
+WinWaiter::~WinWaiter()
+{
+    CloseHandle(hNotify);
+}
+
+// wake up from another thread
+void WinWaiter::notify()
+{
+    SetEvent(hNotify);
 }
 
 // update monotonously increasing timestamp in deciseconds
@@ -75,6 +88,8 @@ int WinWaiter::wait()
 {
     int r = 0;
 
+    addhandle(hNotify, NEEDEXEC);
+
     // only allow interaction of asynccallback() with the main process while
     // waiting (because WinHTTP is threaded)
     if (pcsHTTP)
@@ -0,0 +1,352 @@
+/**
+ * @file workerpool.cpp
+ * @brief Worker threads for CPU-intensive engine tasks
+ *
+ * (c) 2013-2014 by Mega Limited, Wellsford, New Zealand
+ *
+ * This file is part of the MEGA SDK - Client Access Engine.
+ *
+ * Applications using the MEGA API must present a valid application key
+ * and comply with the the rules set forth in the Terms of Service.
+ *
+ * The MEGA SDK is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @copyright Simplified (2-clause) BSD License.
+ *
+ * You should have received a copy of the license along with this
+ * program.
+ */
+
+#include "mega/workerpool.h"
+#include "megathread.h"
+
+namespace mega {
+WorkerPool::WorkerPool(Waiter* w)
+{
+    waiter = w;
+    mutex = new MUTEX_CLASS;
+    queued = new SEMAPHORE_CLASS;
+    canceled = new SEMAPHORE_CLASS;
+    stopping = false;
+    pending = 0;
+}
+
+WorkerPool::~WorkerPool()
+{
+    stop();
+
+    while (pendingq.size())
+    {
+        delete pendingq.front();
+        pendingq.pop_front();
+    }
+
+    while (doneq.size())
+    {
+        delete doneq.front();
+        doneq.pop_front();
+    }
+
+    delete canceled;
+    delete queued;
+    delete mutex;
+}
+
+void* WorkerPool::threadentry(void* pool)
+{
+    ((WorkerPool*)pool)->loop();
+
+    return NULL;
+}
+
+// worker thread main loop
+void WorkerPool::loop()
+{
+    for (;;)
+    {
+        queued->wait();
+
+        mutex->lock();
+
+        if (stopping)
+        {
+            mutex->unlock();
+            break;
+        }
+
+        // (the job may have been canceled while queued)
+        if (!pendingq.size())
+        {
+            mutex->unlock();
+            continue;
+        }
+
+        WorkerJob* job = pendingq.front();
+        pendingq.pop_front();
+
+        mutex->unlock();
+
+        job->run();
+
+        mutex->lock();
+
+        if (abandoned.erase(job))
+        {
+            mutex->unlock();
+            canceled->release();
+        }
+        else
+        {
+            doneq.push_back(job);
+            mutex->unlock();
+            waiter->notify();
+        }
+    }
+}
+
+void WorkerPool::start(unsigned n)
+{
+    stop();
+
+    stopping = false;
+
+    // no threads left to run queued jobs: run them now
+    if (!n)
+    {
+        while (pendingq.size())
+        {
+            WorkerJob* job = pendingq.front();
+
+            pendingq.pop_front();
+            job->run();
+            doneq.push_back(job);
+        }
+    }
+
+    while (n--)
+    {
+        Thread* t = new THREAD_CLASS;
+
+        threads.push_back(t);
+        t->start(threadentry, this);
+    }
+}
+
+void WorkerPool::stop()
+{
+    if (!threads.size())
+    {
+        return;
+    }
+
+    mutex->lock();
+    stopping = true;
+    mutex->unlock();
+
+    for (unsigned i = threads.size(); i--; )
+    {
+        queued->release();
+    }
+
+    for (unsigned i = threads.size(); i--; )
+    {
+        threads[i]->join();
+        delete threads[i];
+    }
+
+    threads.clear();
+}
+
+unsigned WorkerPool::numthreads() const
+{
+    return threads.size();
+}
+
+void WorkerPool::push(WorkerJob* job)
+{
+    pending++;
+
+    if (!threads.size())
+    {
+        job->run();
+        doneq.push_back(job);
+        return;
+    }
+
+    mutex->lock();
+    pendingq.push_back(job);
+    mutex->unlock();
+
+    queued->release();
+}
+
+void WorkerPool::cancel(WorkerJob* job)
+{
+    workerjob_deque::iterator it;
+
+    pending--;
+
+    mutex->lock();
+
+    if ((it = find(pendingq.begin(), pendingq.end(), job)) != pendingq.end())
+    {
+        pendingq.erase(it);
+    }
+    else if ((it = find(doneq.begin(), doneq.end(), job)) != doneq.end())
+    {
+        doneq.erase(it);
+    }
+    else
+    {
+        // currently running: wait for it to finish
+        abandoned.insert(job);
+        mutex->unlock();
+
+        canceled->wait();
+
+        delete job;
+        return;
+    }
+
+    mutex->unlock();
+
+    delete job;
+}
+
+// shared state of a runbatch() invocation
+struct WorkerBatch
+{
+    vector<WorkerJob*>* jobs;
+    size_t next;
+    Mutex* mutex;
+    Semaphore* finished;
+
+    // run jobs until none are left
+    void drain()
+    {
+        for (;;)
+        {
+            mutex->lock();
+            size_t i = next++;
+            mutex->unlock();
+
+            if (i >= jobs->size())
+            {
+                break;
+            }
+
+            (*jobs)[i]->run();
+        }
+    }
+};
+
+// lets a worker thread participate in a batch
+struct WorkerBatchHelper : public WorkerJob
+{
+    WorkerBatch* batch;
+
+    void run()
+    {
+        batch->drain();
+
+        // (the batch may be gone as soon as this returns)
+        batch->finished->release();
+    }
+
+    void complete(MegaClient*)
+    {
+        delete this;
+    }
+
+    WorkerBatchHelper(WorkerBatch* b) : batch(b) { }
+};
+
+void WorkerPool::runbatch(vector<WorkerJob*>* jobs, MegaClient* client)
+{
+    WorkerBatch batch;
+    unsigned helpers = threads.size();
+
+    batch.jobs = jobs;
+    batch.next = 0;
+    batch.mutex = new MUTEX_CLASS;
+    batch.finished = new SEMAPHORE_CLASS;
+
+    if (helpers > jobs->size())
+    {
+        helpers = jobs->size();
+    }
+
+    vector<WorkerJob*> queuedhelpers;
+
+    for (unsigned i = helpers; i--; )
+    {
+        queuedhelpers.push_back(new WorkerBatchHelper(&batch));
+        push(queuedhelpers.back());
+    }
+
+    batch.drain();
+
+    // helpers still queued behind other jobs are withdrawn - only those
+    // that were picked up by a worker thread need to be waited for
+    mutex->lock();
+
+    for (unsigned i = queuedhelpers.size(); i--; )
+    {
+        workerjob_deque::iterator it = find(pendingq.begin(), pendingq.end(), queuedhelpers[i]);
+
+        if (it != pendingq.end())
+        {
+            pendingq.erase(it);
+            delete queuedhelpers[i];
+            pending--;
+            helpers--;
+        }
+    }
+
+    mutex->unlock();
+
+    for (unsigned i = helpers; i--; )
+    {
+        batch.finished->wait();
+    }
+
+    delete batch.finished;
+    delete batch.mutex;
+
+    for (unsigned i = 0; i < jobs->size(); i++)
+    {
+        (*jobs)[i]->complete(client);
+    }
+}
+
+// (one at a time, as complete() may cancel other finished jobs)
+bool WorkerPool::exec(MegaClient* client)
+{
+    bool r = false;
+
+    for (;;)
+    {
+        mutex->lock();
+
+        if (!doneq.size())
+        {
+            mutex->unlock();
+            break;
+        }
+
+        WorkerJob* job = doneq.front();
+        doneq.pop_front();
+
+        mutex->unlock();
+
+        pending--;
+        r = true;
+
+        job->complete(client);
+    }
+
+    return r;
+}
+} // namespace
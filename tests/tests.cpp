@@ -22,6 +22,8 @@
 #include "mega.h"
 #include "gtest/gtest.h"
 
+using namespace mega;
+
 bool debug;
 
 TEST(JSON, storeobject) {
@@ -30,6 +32,682 @@ TEST(JSON, storeobject) {
   j.storeobject (&in_str);
 }
 
+// all string scanning kernels must agree with the portable one
+TEST(JSON, stringend) {
+  static const char* const strs[] = { "\"", "abc\"", "a\\\"b\"", "a\\\\\"", "\\",
+                                      "01234567890123456789012345678901234567890\\\"x\"",
+                                      "0123456789012345678901234567890123456789" };
+  int simd = JSON::simd;
+
+  for (unsigned i = 0; i < sizeof strs / sizeof *strs; i++)
+  {
+      for (unsigned offset = 0; offset < 32; offset++)
+      {
+          string buf = string(offset, ' ') + strs[i];
+          const char* ptr = buf.c_str() + offset;
+
+          JSON::simd = 0;
+          const char* portable = JSON::stringend(ptr);
+
+          for (JSON::simd = 1; JSON::simd <= simd; JSON::simd++)
+          {
+              ASSERT_EQ(portable, JSON::stringend(ptr));
+          }
+      }
+  }
+
+  JSON::simd = simd;
+}
+
+// decoding must not read past the terminator of a buffer sized exactly to
+// the encoded value (build with -fsanitize=address to catch overreads)
+TEST(Base64, atob_bounds) {
+  byte data[96], decoded[sizeof data];
+
+  PrnGen::genblock(data, sizeof data);
+
+  for (int len = 0; len <= (int)sizeof data; len++)
+  {
+      char buf[sizeof data * 4 / 3 + 4];
+      int alen = Base64::btoa(data, len, buf);
+
+      for (int simd = 0; simd < 2; simd++)
+      {
+          bool usessse3 = Base64::usessse3;
+          char* encoded = new char[alen + 1];
+
+          memcpy(encoded, buf, alen + 1);
+
+          Base64::usessse3 = usessse3 && simd;
+          int dlen = Base64::atob(encoded, decoded, sizeof decoded);
+          Base64::usessse3 = usessse3;
+
+          delete[] encoded;
+
+          ASSERT_EQ(len, dlen);
+          ASSERT_EQ(0, memcmp(data, decoded, len));
+      }
+  }
+}
+
+// the SSSE3 decoder must agree with the table-driven one, including on
+// values that end in invalid characters or do not fit the output buffer
+TEST(Base64, atob_ssse3) {
+  if (!Base64::usessse3)
+  {
+      return;
+  }
+
+  byte data[96];
+  char encoded[130];
+
+  PrnGen::genblock(data, sizeof data);
+
+  for (int len = 0; len <= (int)sizeof data; len++)
+  {
+      // terminated as a JSON string value
+      strcpy(encoded + Base64::btoa(data, len, encoded), "\"");
+
+      for (int blen = 0; blen <= len + 2; blen += 5)
+      {
+          byte fast[sizeof data + 2], portable[sizeof data + 2];
+
+          memset(fast, 0, sizeof fast);
+          memset(portable, 0, sizeof portable);
+
+          int fastlen = Base64::atob(encoded, fast, blen);
+
+          Base64::usessse3 = false;
+          int portablelen = Base64::atob(encoded, portable, blen);
+          Base64::usessse3 = true;
+
+          ASSERT_EQ(portablelen, fastlen);
+          ASSERT_EQ(0, memcmp(portable, fast, sizeof fast));
+      }
+
+      byte decoded[sizeof data];
+
+      ASSERT_EQ(len, Base64::atob(encoded, decoded, sizeof decoded));
+      ASSERT_EQ(0, memcmp(data, decoded, len));
+  }
+}
+
+// the AES-NI ctr_crypt() kernel must be bit-identical to the portable path
+TEST(SymmCipher, ctr_crypt_aesni) {
+  if (!SymmCipher::useaesni)
+  {
+      return;
+  }
+
+  byte keybuf[SymmCipher::KEYLENGTH];
+  PrnGen::genblock(keybuf, sizeof keybuf);
+
+  SymmCipher key(keybuf);
+
+  static const unsigned lens[] = { 0, 1, 15, 16, 17, 63, 64, 65, 1000, 131072 };
+
+  for (unsigned i = 0; i < sizeof lens / sizeof *lens; i++)
+  {
+      for (int encrypt = 0; encrypt < 2; encrypt++)
+      {
+          unsigned padded = (lens[i] + SymmCipher::BLOCKSIZE - 1) & -SymmCipher::BLOCKSIZE;
+          string plain(padded, 0), fast, portable;
+          byte fastmac[SymmCipher::BLOCKSIZE], portablemac[SymmCipher::BLOCKSIZE];
+          SymmCipher::ctr_iv ctriv = 0x0123456789abcdefULL * (i + 1);
+          m_off_t pos = 16 * 1048573LL * i;
+
+          PrnGen::genblock((byte*)plain.data(), lens[i]);
+
+          fast = portable = plain;
+
+          key.ctr_crypt((byte*)fast.data(), lens[i], pos, ctriv, fastmac, encrypt);
+
+          SymmCipher::useaesni = false;
+          key.ctr_crypt((byte*)portable.data(), lens[i], pos, ctriv, portablemac, encrypt);
+          SymmCipher::useaesni = true;
+
+          ASSERT_EQ(portable, fast);
+          ASSERT_EQ(0, memcmp(portablemac, fastmac, sizeof fastmac));
+      }
+  }
+}
+
+// the PCLMUL CRC32 must match Crypto++'s for any split of the input
+TEST(HashCRC32, pclmul) {
+  if (!HashCRC32::usepclmul)
+  {
+      return;
+  }
+
+  byte data[4096];
+  PrnGen::genblock(data, sizeof data);
+
+  static const unsigned lens[] = { 0, 1, 15, 16, 63, 64, 65, 127, 2048, 4096 };
+
+  for (unsigned i = 0; i < sizeof lens / sizeof *lens; i++)
+  {
+      for (unsigned split = 0; split <= lens[i]; split += 37)
+      {
+          byte fast[4], portable[4];
+          HashCRC32 fastcrc;
+
+          fastcrc.add(data, split);
+          fastcrc.add(data + split, lens[i] - split);
+          fastcrc.get(fast);
+
+          HashCRC32::usepclmul = false;
+
+          HashCRC32 portablecrc;
+
+          portablecrc.add(data, lens[i]);
+          portablecrc.get(portable);
+
+          HashCRC32::usepclmul = true;
+
+          ASSERT_EQ(0, memcmp(portable, fast, sizeof fast));
+      }
+  }
+}
+
+// a request spanning several chunks must yield the same per-chunk MACs
+TEST(HttpReqXfer, chunkcrypt) {
+  byte keybuf[SymmCipher::KEYLENGTH];
+  PrnGen::genblock(keybuf, sizeof keybuf);
+
+  SymmCipher key(keybuf);
+  SymmCipher::ctr_iv ctriv = 0x0123456789abcdefULL;
+
+  // three chunks plus a partial fourth one
+  m_off_t end = ChunkedHash::chunkceil(ChunkedHash::chunkceil(ChunkedHash::chunkceil(0))) + 1000;
+  string plain(end, 0), coalesced, single;
+  chunkmac_map coalescedmacs, singlemacs;
+
+  PrnGen::genblock((byte*)plain.data(), end);
+
+  coalesced = single = plain;
+
+  HttpReqXfer::chunkcrypt(&key, (byte*)coalesced.data(), end, 0, ctriv, &coalescedmacs, 1);
+
+  for (m_off_t pos = 0; pos < end; pos = ChunkedHash::chunkceil(pos))
+  {
+      m_off_t npos = ChunkedHash::chunkceil(pos) < end ? ChunkedHash::chunkceil(pos) : end;
+
+      key.ctr_crypt((byte*)single.data() + pos, npos - pos, pos, ctriv, singlemacs[pos].mac, 1);
+  }
+
+  ASSERT_EQ(single, coalesced);
+  ASSERT_EQ(4u, coalescedmacs.size());
+
+  for (chunkmac_map::iterator it = singlemacs.begin(); it != singlemacs.end(); it++)
+  {
+      ASSERT_EQ(0, memcmp(it->second.mac, coalescedmacs[it->first].mac, sizeof it->second.mac));
+  }
+}
+
+// NodeTable must behave like the std::map it replaces
+TEST(NodeTable, consistency) {
+  NodeTable table;
+  map<handle, Node*> reference;
+
+  for (int i = 0; i < 200000; i++)
+  {
+      handle h = rand() % 5000;
+
+      if (rand() % 3)
+      {
+          Node* n = (Node*)(uintptr_t)((rand() << 3) | 8);
+
+          table.set(h, n);
+          reference[h] = n;
+      }
+      else
+      {
+          ASSERT_EQ(reference.erase(h), table.erase(h));
+      }
+  }
+
+  ASSERT_EQ(reference.size(), table.size());
+
+  for (map<handle, Node*>::iterator it = reference.begin(); it != reference.end(); it++)
+  {
+      NodeTable::iterator nit = table.find(it->first);
+
+      ASSERT_TRUE(nit != table.end());
+      ASSERT_EQ(it->second, nit->second);
+  }
+
+  size_t count = 0;
+
+  for (NodeTable::iterator it = table.begin(); it != table.end(); it++)
+  {
+      count++;
+  }
+
+  ASSERT_EQ(reference.size(), count);
+}
+
+TEST(SlabAllocator, reuse) {
+  SlabAllocator slab(40, 16);
+  vector<void*> objs;
+
+  for (int i = 0; i < 100; i++)
+  {
+      objs.push_back(slab.alloc(40));
+      ASSERT_EQ(0u, (uintptr_t)objs.back() % SlabAllocator::HEADERSIZE);
+  }
+
+  // oversized requests are served from the heap
+  void* big = slab.alloc(1000);
+
+  ASSERT_EQ(100u, slab.inuse());
+  ASSERT_FALSE(slab.purge());
+
+  SlabAllocator::release(objs[10]);
+
+  // released objects are recycled first
+  ASSERT_EQ(objs[10], slab.alloc(40));
+
+  for (unsigned i = 0; i < objs.size(); i++)
+  {
+      SlabAllocator::release(objs[i]);
+  }
+
+  SlabAllocator::release(big);
+
+  ASSERT_EQ(0u, slab.inuse());
+  ASSERT_TRUE(slab.purge());
+  ASSERT_EQ(0u, slab.footprint());
+}
+
+struct SquareJob : public WorkerJob
+{
+    unsigned in, out;
+    bool completed;
+
+    void run() { out = in * in; }
+    void complete(MegaClient*) { completed = true; }
+};
+
+// every batch job must have been run and completed once runbatch() returns
+TEST(WorkerPool, runbatch) {
+  WAIT_CLASS waiter;
+  WorkerPool pool(&waiter);
+
+  for (unsigned threads = 0; threads < 4; threads += 3)
+  {
+      pool.start(threads);
+
+      vector<SquareJob> squares(1000);
+      vector<WorkerJob*> jobs;
+
+      for (unsigned i = 0; i < squares.size(); i++)
+      {
+          squares[i].in = i;
+          squares[i].out = 0;
+          squares[i].completed = false;
+          jobs.push_back(&squares[i]);
+      }
+
+      pool.runbatch(&jobs, NULL);
+
+      for (unsigned i = 0; i < squares.size(); i++)
+      {
+          ASSERT_EQ(i * i, squares[i].out);
+          ASSERT_TRUE(squares[i].completed);
+      }
+
+      // (finished helper jobs delete themselves on completion)
+      pool.exec(NULL);
+      pool.stop();
+  }
+}
+
+// committed changes must survive reopening, aborted ones must not
+TEST(LogDbTable, persistence) {
+  FSACCESS_CLASS fsaccess;
+  LogDbAccess dbaccess;
+  string name = "logdbtest";
+  string data;
+  uint32_t id;
+  char a[] = "a", bb[] = "bb", ccc[] = "ccc";
+
+  DbTable* table = dbaccess.open(&fsaccess, &name);
+  ASSERT_TRUE(table != NULL);
+
+  table->truncate();
+  table->begin();
+  ASSERT_TRUE(table->put(16, a, 1));
+  ASSERT_TRUE(table->put(32, bb, 2));
+  ASSERT_TRUE(table->put(48, ccc, 3));
+  table->commit();
+
+  table->begin();
+  ASSERT_TRUE(table->del(32));
+  table->commit();
+
+  table->begin();
+  ASSERT_TRUE(table->del(16));
+  table->abort();
+
+  delete table;
+
+  table = dbaccess.open(&fsaccess, &name);
+  ASSERT_TRUE(table != NULL);
+
+  ASSERT_TRUE(table->get(16, &data));
+  ASSERT_EQ("a", data);
+  ASSERT_FALSE(table->get(32, &data));
+
+  unsigned count = 0;
+  table->rewind();
+
+  while (table->next(&id, &data))
+  {
+      ASSERT_TRUE(id == 16 || id == 48);
+      count++;
+  }
+
+  ASSERT_EQ(2u, count);
+
+  table->truncate();
+  delete table;
+}
+
+struct FetchNodesApp : public MegaApp
+{
+    error result;
+
+    void fetchnodes_result(error e) { result = e; }
+};
+
+static string fetchnodesresponse(vector<string>* elements)
+{
+  string response("[{\"f\":[");
+
+  // (some nodes arrive before their parents)
+  random_shuffle(elements->begin(), elements->end());
+
+  for (size_t i = 0; i < elements->size(); i++)
+  {
+      if (i)
+      {
+          response.append(",");
+      }
+
+      response.append((*elements)[i]);
+  }
+
+  response.append("],\"sn\":\"AAAAAAAAAAA\"}]");
+
+  return response;
+}
+
+// load a fetchnodes response into a fresh client in random chunks (seed 0:
+// all at once), optionally after losing the connection halfway through an
+// earlier response - returns each node's parent
+static map<handle, handle> fetchnodes(const string& response, unsigned seed, const string* lost)
+{
+  FetchNodesApp app;
+  WAIT_CLASS waiter;
+  HTTPIO_CLASS httpio;
+  FSACCESS_CLASS fsaccess;
+  MegaClient client(&app, &waiter, &httpio, &fsaccess, NULL, NULL, "test", "test");
+  Request request;
+  HttpReq req;
+
+  srand(seed);
+  request.add(new CommandFetchNodes(&client));
+
+  for (int attempt = lost ? 2 : 1; attempt--; )
+  {
+      const string* in = attempt ? lost : &response;
+      size_t end = attempt ? in->size() / 2 : in->size();
+
+      req.in.clear();
+
+      for (size_t pos = 0, len; pos < end; pos += len)
+      {
+          len = seed ? 1 + rand() % 300 : end;
+
+          if (len > end - pos)
+          {
+              len = end - pos;
+          }
+
+          req.in.append(*in, pos, len);
+
+          if (seed)
+          {
+              request.procpartial(&client, &req);
+          }
+      }
+
+      if (attempt)
+      {
+          request.cancelpartial(&client);
+      }
+  }
+
+  client.json.begin(req.in.c_str());
+  request.procresult(&client);
+
+  EXPECT_EQ(API_OK, app.result);
+
+  map<handle, handle> tree;
+
+  for (node_map::iterator it = client.nodes.begin(); it != client.nodes.end(); it++)
+  {
+      tree[it->first] = it->second->parent ? it->second->parent->nodehandle : UNDEF;
+  }
+
+  return tree;
+}
+
+// streamed parsing must yield the same tree as parsing the complete response,
+// also when retried after nodes were deleted on the server
+TEST(CommandFetchNodes, procpartial) {
+  vector<handle> folders(1, 1);
+  vector<string> elements;
+  char h[16], p[16];
+
+  Base64::btoa((byte*)&folders[0], MegaClient::NODEHANDLE, h);
+  elements.push_back(string("{\"h\":\"") + h + "\",\"t\":2,\"u\":\"BBBBBBBBBBB\",\"ts\":1}");
+
+  for (handle i = 2; i < 2500; i++)
+  {
+      bool folder = i < 2000 && !(rand() % 4);
+      char element[256];
+
+      Base64::btoa((byte*)&i, MegaClient::NODEHANDLE, h);
+      Base64::btoa((byte*)&folders[rand() % folders.size()], MegaClient::NODEHANDLE, p);
+
+      snprintf(element, sizeof element,
+               "{\"h\":\"%s\",\"p\":\"%s\",\"u\":\"BBBBBBBBBBB\",\"t\":%d,\"a\":\"attr\","
+               "\"k\":\"BBBBBBBBBBB:key\",\"s\":%d,\"ts\":1}",
+               h, p, folder ? FOLDERNODE : FILENODE, folder ? 0 : rand());
+
+      elements.push_back(element);
+
+      if (folder)
+      {
+          folders.push_back(i);
+      }
+  }
+
+  // the lost response still carries the files that were deleted since
+  vector<string> previous(elements);
+  string lost = fetchnodesresponse(&previous);
+
+  elements.resize(2000);
+
+  string response = fetchnodesresponse(&elements);
+  map<handle, handle> reference = fetchnodes(response, 0, NULL);
+
+  ASSERT_EQ(elements.size(), reference.size());
+
+  for (unsigned seed = 1; seed < 20; seed++)
+  {
+      ASSERT_TRUE(reference == fetchnodes(response, seed, NULL));
+      ASSERT_TRUE(reference == fetchnodes(response, seed, &lost));
+  }
+}
+
+// LRU eviction from memory and table, invalidation by attribute handle,
+// reloading from the table
+TEST(FileAttributeCache, lru) {
+  FSACCESS_CLASS fsaccess;
+  LogDbAccess dbaccess;
+  string name = "facachetest";
+  string data;
+  SymmCipher key;
+  byte keydata[SymmCipher::KEYLENGTH] = { 1, 2, 3 };
+  char buf[100];
+
+  key.setkey(keydata);
+  memset(buf, 'x', sizeof buf);
+
+  DbTable* table = dbaccess.open(&fsaccess, &name);
+  ASSERT_TRUE(table != NULL);
+  table->truncate();
+
+  FileAttributeCache cache(150, 250);
+  cache.attach(table, &key);
+
+  for (handle h = 1; h <= 3; h++)
+  {
+      buf[0] = (char)h;
+      cache.put(h, 0, h + 100, buf, sizeof buf);
+  }
+
+  // table holds the two most recent, memory only the last one
+  ASSERT_FALSE(cache.get(1, 0, 101, &data));
+  ASSERT_TRUE(cache.get(2, 0, 102, &data));
+  ASSERT_EQ(sizeof buf, data.size());
+  ASSERT_EQ(2, data[0]);
+  ASSERT_TRUE(cache.get(3, 0, 103, &data));
+  ASSERT_EQ(3, data[0]);
+
+  // replaced attribute
+  ASSERT_FALSE(cache.get(3, 0, 104, &data));
+  ASSERT_FALSE(cache.get(3, 0, 103, &data));
+  ASSERT_EQ(2u, cache.hits);
+  ASSERT_EQ(3u, cache.misses);
+
+  cache.reset();
+
+  table = dbaccess.open(&fsaccess, &name);
+  ASSERT_TRUE(table != NULL);
+  cache.attach(table, &key);
+
+  // data is only read once requested
+  ASSERT_EQ(100, cache.disksize);
+  ASSERT_EQ(0u, cache.memsize);
+  ASSERT_TRUE(cache.get(2, 0, 102, &data));
+  ASSERT_EQ(sizeof buf, data.size());
+  ASSERT_EQ(2, data[0]);
+  ASSERT_EQ(100u, cache.memsize);
+
+  cache.reset();
+
+  table = dbaccess.open(&fsaccess, &name);
+  table->truncate();
+  delete table;
+}
+
+struct FaCompleteApp : public MegaApp
+{
+    map<handle, string> attributes;
+
+    void fa_complete(Node* n, fatype, const char* data, uint32_t len)
+    {
+        attributes[n->nodehandle].assign(data, len);
+    }
+};
+
+// attributes must be delivered and freed from the buffer as they arrive,
+// regardless of where the response is split (inside the record index or
+// inside an attribute)
+TEST(FileAttributeFetchChannel, parse) {
+  FaCompleteApp app;
+  WAIT_CLASS waiter;
+  HTTPIO_CLASS httpio;
+  FSACCESS_CLASS fsaccess;
+  MegaClient client(&app, &waiter, &httpio, &fsaccess, NULL, NULL, "test", "test");
+  node_vector dp;
+  map<handle, string> expected;
+  string index, body;
+  const handle count = 20;
+  const size_t maxchunk = 700, maxlen = 64 * SymmCipher::BLOCKSIZE;
+
+  for (handle h = 1; h <= count; h++)
+  {
+      Node* n = new(&client) Node(&client, &dp, h, UNDEF, FILENODE, 0, 0, "", 1, 1);
+      byte key[FILENODEKEYLENGTH];
+      SymmCipher cipher;
+      string data(SymmCipher::BLOCKSIZE * (1 + rand() % (maxlen / SymmCipher::BLOCKSIZE)), 0);
+      handle fah = h + 1000;
+      uint32_t pos = count * (sizeof(handle) + sizeof(uint32_t)) + body.size();
+
+      PrnGen::genblock(key, sizeof key);
+      PrnGen::genblock((byte*)data.data(), data.size());
+
+      n->setkey(key);
+      expected[h] = data;
+
+      cipher.setkey(key, FILENODE);
+      cipher.cbc_encrypt((byte*)data.data(), data.size());
+
+      index.append((char*)&fah, sizeof fah);
+      index.append((char*)&pos, sizeof pos);
+      body.append(data);
+  }
+
+  string response = index + body;
+
+  for (unsigned seed = 0; seed < 50; seed++)
+  {
+      FileAttributeFetchChannel fc;
+      size_t maxbuffered = 0;
+
+      for (handle h = 1; h <= count; h++)
+      {
+          client.fafs[h + 1000] = new FileAttributeFetch(h, 0, 0, 0);
+      }
+
+      app.attributes.clear();
+      fc.req.incremental = true;
+      srand(seed);
+
+      for (size_t pos = 0, len; pos < response.size(); pos += len)
+      {
+          len = 1 + rand() % maxchunk;
+
+          if (len > response.size() - pos)
+          {
+              len = response.size() - pos;
+          }
+
+          fc.req.in.append(response, pos, len);
+          fc.parse(&client, 0, false);
+
+          // only undelivered data is held
+          ASSERT_EQ(pos + len, fc.inbase + fc.req.in.size());
+
+          if (fc.req.in.size() > maxbuffered)
+          {
+              maxbuffered = fc.req.in.size();
+          }
+      }
+
+      fc.parse(&client, 0, true);
+
+      ASSERT_TRUE(expected == app.attributes);
+      ASSERT_TRUE(client.fafs.empty());
+      ASSERT_EQ(0u, fc.req.in.size());
+      ASSERT_LT(maxbuffered, index.size() + maxlen + maxchunk);
+  }
+}
+
 int main (int argc, char *argv[])
 {
     return RUN_ALL_TESTS();